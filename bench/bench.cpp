@@ -0,0 +1,579 @@
+// anomsched_bench: microbenchmarks for the scheduler's hot paths, with
+// console or Google Benchmark-compatible JSON output, so two commits can be
+// compared with Google Benchmark's tools/compare.py:
+//
+//   anomsched_bench --benchmark_out=before.json
+//   anomsched_bench --benchmark_filter='EmptyJob.*' --benchmark_min_time=2
+//
+// Each benchmark runs with growing iteration counts until one run takes at
+// least --benchmark_min_time seconds; setup (pools, logs, pre-filled queues)
+// is excluded from the timing. real_time is wall time per iteration and
+// cpu_time is process CPU time per iteration, so for multi-threaded cases it
+// includes the workers.
+#include "job_queue.hpp"
+#include "latency_histogram.hpp"
+#include "logger.hpp"
+#include "scheduler.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Handed to a benchmark body: run `iterations` iterations, bracketing the
+    // measured part with resume()/pause()
+    class BenchState
+    {
+    public:
+        explicit BenchState(uint64_t iterations_) : iterations(iterations_) {}
+
+        const uint64_t iterations;
+        double items = 0;                        // items processed, for items_per_second
+        std::map<std::string, double> counters;  // extra per-run values, emitted as-is
+
+        void resume()
+        {
+            wall_start = Clock::now();
+            cpu_start = std::clock();
+        }
+        void pause()
+        {
+            wall_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - wall_start).count();
+            cpu_ns += double(std::clock() - cpu_start) * 1e9 / CLOCKS_PER_SEC;
+        }
+
+        // For bodies that time a sub-step themselves instead of resume()/pause()
+        void addManualTime(int64_t ns)
+        {
+            wall_ns += ns;
+        }
+
+        double wallNs() const { return double(wall_ns); }
+        double cpuNs() const { return cpu_ns; }
+
+    private:
+        Clock::time_point wall_start;
+        std::clock_t cpu_start = 0;
+        int64_t wall_ns = 0;
+        double cpu_ns = 0;
+    };
+
+    struct Benchmark
+    {
+        std::string family;
+        std::string name;
+        std::function<void(BenchState &)> body;
+    };
+
+    struct Result
+    {
+        const Benchmark *benchmark = nullptr;
+        int family_index = 0;
+        int instance_index = 0;
+        int repetition = 0;
+        uint64_t iterations = 0;
+        double real_ns = 0; // per iteration
+        double cpu_ns = 0;
+        double items_per_second = 0;
+        std::map<std::string, double> counters;
+    };
+
+    std::string scratchLog(const char *extension)
+    {
+        return (std::filesystem::temp_directory_path() / (std::string("anomsched_bench") + extension)).string();
+    }
+
+    void removeLog(const std::string &path)
+    {
+        std::error_code ignored;
+        std::filesystem::remove(path, ignored);
+    }
+
+    // Pools under benchmark keep anomaly lines off the report
+    SchedulerOptions quietOptions()
+    {
+        SchedulerOptions options;
+        options.print_anomalies = false;
+        return options;
+    }
+
+    void spinUntil(const std::atomic<uint64_t> &value, uint64_t target)
+    {
+        while (value.load(std::memory_order_acquire) < target)
+            std::this_thread::yield();
+    }
+
+    // ------------------- Benchmarks ---------------------
+
+    // One push and one pop on a heap holding `depth` jobs
+    void queuePushPop(BenchState &state, int depth)
+    {
+        JobQueue queue;
+        for (int i = 0; i < depth; ++i)
+            queue.push(Job(i, i % 10, [] {}));
+        Job job(0, 5, [] {});
+        state.resume();
+        for (uint64_t i = 0; i < state.iterations; ++i)
+        {
+            job.priority = int(i % 10);
+            queue.push(std::move(job));
+            job = queue.pop();
+        }
+        state.pause();
+        state.items = double(state.iterations);
+    }
+
+    // Submit-to-completion of trivial jobs from `producers` threads
+    void emptyJobThroughput(BenchState &state, int workers, int producers)
+    {
+        std::string log = scratchLog(".bin");
+        {
+            Scheduler scheduler(workers, log, quietOptions());
+            scheduler.start();
+            std::atomic<uint64_t> done{0};
+            state.resume();
+            std::vector<std::thread> threads;
+            for (int p = 0; p < producers; ++p)
+            {
+                uint64_t share = state.iterations / producers + (uint64_t(p) < state.iterations % producers ? 1 : 0);
+                threads.emplace_back([&scheduler, &done, share]
+                                     {
+                    for (uint64_t i = 0; i < share; ++i)
+                        scheduler.submitJob([&done] { done.fetch_add(1, std::memory_order_release); }, int(i % 10)); });
+            }
+            for (auto &t : threads)
+                t.join();
+            spinUntil(done, state.iterations);
+            state.pause();
+            scheduler.stop();
+        }
+        removeLog(log);
+        state.items = double(state.iterations);
+    }
+
+    // Cost of submitJob() alone, as seen by one producer
+    void submitLatency(BenchState &state, int workers)
+    {
+        std::string log = scratchLog(".bin");
+        {
+            Scheduler scheduler(workers, log, quietOptions());
+            scheduler.start();
+            std::atomic<uint64_t> done{0};
+            state.resume();
+            for (uint64_t i = 0; i < state.iterations; ++i)
+                scheduler.submitJob([&done] { done.fetch_add(1, std::memory_order_release); }, int(i % 10));
+            state.pause();
+            spinUntil(done, state.iterations);
+            scheduler.stop();
+        }
+        removeLog(log);
+        state.items = double(state.iterations);
+    }
+
+    // Jobs that each submit `fan_out` children into a Block queue of 8 slots.
+    // Workers find the queue full and run children themselves; before they
+    // did, this hung with every worker waiting for a slot.
+    void fanOutFullQueue(BenchState &state, int workers, int fan_out)
+    {
+        std::string log = scratchLog(".bin");
+        {
+            SchedulerOptions options = quietOptions();
+            options.queue_capacity = 8;
+            options.overflow_policy = OverflowPolicy::Block;
+            Scheduler scheduler(workers, log, options);
+            scheduler.start();
+            std::atomic<uint64_t> done{0};
+            state.resume();
+            for (uint64_t i = 0; i < state.iterations; ++i)
+            {
+                scheduler.submitJob([&scheduler, &done, fan_out]
+                                    {
+                    for (int c = 0; c < fan_out; ++c)
+                        scheduler.submitJob([&done] { done.fetch_add(1, std::memory_order_release); }); });
+            }
+            spinUntil(done, state.iterations * fan_out);
+            state.pause();
+            scheduler.stop();
+        }
+        removeLog(log);
+        state.items = double(state.iterations * fan_out);
+    }
+
+    // Submit to an idle pool until the job starts running: condvar wake plus
+    // dequeue. One job in flight at a time, so every job wakes a worker; only
+    // submit-to-start is timed (manual time), cpu_time is not measured.
+    void wakeLatency(BenchState &state, int workers)
+    {
+        std::string log = scratchLog(".bin");
+        LatencyHistogram latency;
+        {
+            Scheduler scheduler(workers, log, quietOptions());
+            scheduler.start();
+            std::atomic<uint64_t> done{0};
+            std::atomic<int64_t> started_ns{0};
+            for (uint64_t i = 0; i < state.iterations; ++i)
+            {
+                // Let the worker finish logging and go back to sleep
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+                auto submitted = Clock::now();
+                scheduler.submitJob([&]
+                                    {
+                    started_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - submitted).count(),
+                                     std::memory_order_relaxed);
+                    done.fetch_add(1, std::memory_order_release); });
+                spinUntil(done, i + 1);
+                int64_t ns = started_ns.load(std::memory_order_relaxed);
+                latency.record(ns);
+                state.addManualTime(ns);
+            }
+            scheduler.stop();
+        }
+        removeLog(log);
+        LatencyStats stats = latency.snapshot().stats();
+        state.counters["p50_us"] = stats.p50_us;
+        state.counters["p99_us"] = stats.p99_us;
+    }
+
+    ExecutionRecord syntheticRecord(uint64_t i)
+    {
+        ExecutionRecord record;
+        record.job_id = i + 1;
+        record.thread_id = int32_t(i % 8);
+        record.priority = int32_t(i % 10);
+        record.submit_ns = 1700000000000000000LL + int64_t(i) * 20000;
+        record.start_ns = record.submit_ns + 5000 + int64_t(i % 7) * 1000;
+        record.end_ns = record.start_ns + 30000 + int64_t(i % 13) * 100000;
+        return record;
+    }
+
+    // Logger::log() plus the final flush, for one output format
+    void loggerThroughput(BenchState &state, const char *extension)
+    {
+        std::string log = scratchLog(extension);
+        {
+            Logger logger(log, LogFormat::Auto, 8);
+            logger.setPrintAnomalies(false);
+            std::vector<ExecutionRecord> records;
+            records.reserve(4096);
+            for (uint64_t i = 0; i < 4096; ++i)
+                records.push_back(syntheticRecord(i));
+            state.resume();
+            for (uint64_t i = 0; i < state.iterations; ++i)
+            {
+                ExecutionRecord record = records[i & 4095];
+                record.job_id = i + 1;
+                logger.log(record);
+            }
+            logger.flush();
+            state.pause();
+        }
+        removeLog(log);
+        state.items = double(state.iterations);
+    }
+
+    // Logger::log() with sampling that persists nothing: the real-time
+    // detector and queue-wait EWMA update, under the log lock
+    void detectorUpdate(BenchState &state)
+    {
+        std::string log = scratchLog(".bin");
+        {
+            LogSampling sampling;
+            sampling.mode = SamplingMode::OneInN;
+            sampling.one_in_n = std::numeric_limits<uint32_t>::max();
+            sampling.keep_anomalies = false;
+            Logger logger(log, LogFormat::Auto, 8, LogRotation(), sampling);
+            logger.setPrintAnomalies(false);
+            state.resume();
+            for (uint64_t i = 0; i < state.iterations; ++i)
+                logger.log(syntheticRecord(i));
+            state.pause();
+        }
+        removeLog(log);
+        state.items = double(state.iterations);
+    }
+
+    std::vector<Benchmark> registry()
+    {
+        std::vector<Benchmark> list;
+        for (int depth : {16, 1024, 65536})
+            list.push_back({"BM_QueuePushPop", "BM_QueuePushPop/depth:" + std::to_string(depth),
+                            [depth](BenchState &s) { queuePushPop(s, depth); }});
+        for (int producers : {1, 4})
+        {
+            for (int workers : {1, 2, 4, 8})
+                list.push_back({"BM_EmptyJobThroughput",
+                                "BM_EmptyJobThroughput/workers:" + std::to_string(workers) +
+                                    "/producers:" + std::to_string(producers),
+                                [workers, producers](BenchState &s) { emptyJobThroughput(s, workers, producers); }});
+        }
+        for (int workers : {1, 4, 8})
+            list.push_back({"BM_SubmitLatency", "BM_SubmitLatency/workers:" + std::to_string(workers),
+                            [workers](BenchState &s) { submitLatency(s, workers); }});
+        for (int workers : {1, 4})
+            list.push_back({"BM_FanOutFullQueue", "BM_FanOutFullQueue/workers:" + std::to_string(workers),
+                            [workers](BenchState &s) { fanOutFullQueue(s, workers, 16); }});
+        for (int workers : {1, 4})
+            list.push_back({"BM_WakeLatency", "BM_WakeLatency/workers:" + std::to_string(workers),
+                            [workers](BenchState &s) { wakeLatency(s, workers); }});
+        for (const char *extension : {".csv", ".bin", ".binz"})
+            list.push_back({"BM_LoggerThroughput", std::string("BM_LoggerThroughput/format:") + (extension + 1),
+                            [extension](BenchState &s) { loggerThroughput(s, extension); }});
+        list.push_back({"BM_DetectorUpdate", "BM_DetectorUpdate", [](BenchState &s) { detectorUpdate(s); }});
+        return list;
+    }
+
+    // ------------------- Runner ---------------------
+
+    Result runBenchmark(const Benchmark &benchmark, double min_time_s)
+    {
+        uint64_t iterations = 1;
+        while (true)
+        {
+            BenchState state(iterations);
+            benchmark.body(state);
+            double real_ns = state.wallNs();
+            double seconds = real_ns / 1e9;
+            if (seconds >= min_time_s || iterations >= 1000000000ull)
+            {
+                Result result;
+                result.benchmark = &benchmark;
+                result.iterations = iterations;
+                result.real_ns = real_ns / iterations;
+                result.cpu_ns = state.cpuNs() / iterations;
+                result.items_per_second = state.items > 0 && seconds > 0 ? state.items / seconds : 0;
+                result.counters = state.counters;
+                return result;
+            }
+            // Same growth rule as Google Benchmark: aim 40% past the target,
+            // at most 10x per step
+            double scale = seconds > 0 ? 1.4 * min_time_s / seconds : 10.0;
+            uint64_t next = uint64_t(double(iterations) * std::min(scale, 10.0));
+            iterations = std::max(next, iterations + 1);
+        }
+    }
+
+    std::string jsonEscape(const std::string &s)
+    {
+        std::string out;
+        for (char c : s)
+        {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            out += c;
+        }
+        return out;
+    }
+
+    void writeJson(std::ostream &out, const std::vector<Result> &results, const char *argv0, int repetitions)
+    {
+        char date[64];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", std::localtime(&now));
+        const char *host = std::getenv("HOSTNAME");
+
+        out << "{\n  \"context\": {\n"
+            << "    \"date\": \"" << date << "\",\n"
+            << "    \"host_name\": \"" << jsonEscape(host ? host : "") << "\",\n"
+            << "    \"executable\": \"" << jsonEscape(argv0) << "\",\n"
+            << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+            << "    \"mhz_per_cpu\": 0,\n"
+            << "    \"cpu_scaling_enabled\": false,\n"
+            << "    \"caches\": [],\n"
+#ifdef NDEBUG
+            << "    \"library_build_type\": \"release\"\n"
+#else
+            << "    \"library_build_type\": \"debug\"\n"
+#endif
+            << "  },\n  \"benchmarks\": [";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result &r = results[i];
+            char number[64];
+            out << (i ? "," : "") << "\n    {\n"
+                << "      \"name\": \"" << jsonEscape(r.benchmark->name) << "\",\n"
+                << "      \"family_index\": " << r.family_index << ",\n"
+                << "      \"per_family_instance_index\": " << r.instance_index << ",\n"
+                << "      \"run_name\": \"" << jsonEscape(r.benchmark->name) << "\",\n"
+                << "      \"run_type\": \"iteration\",\n"
+                << "      \"repetitions\": " << repetitions << ",\n"
+                << "      \"repetition_index\": " << r.repetition << ",\n"
+                << "      \"threads\": 1,\n"
+                << "      \"iterations\": " << r.iterations << ",\n";
+            std::snprintf(number, sizeof(number), "%.6g", r.real_ns);
+            out << "      \"real_time\": " << number << ",\n";
+            std::snprintf(number, sizeof(number), "%.6g", r.cpu_ns);
+            out << "      \"cpu_time\": " << number << ",\n"
+                << "      \"time_unit\": \"ns\"";
+            if (r.items_per_second > 0)
+            {
+                std::snprintf(number, sizeof(number), "%.6g", r.items_per_second);
+                out << ",\n      \"items_per_second\": " << number;
+            }
+            for (const auto &counter : r.counters)
+            {
+                std::snprintf(number, sizeof(number), "%.6g", counter.second);
+                out << ",\n      \"" << jsonEscape(counter.first) << "\": " << number;
+            }
+            out << "\n    }";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    void writeConsoleHeader(std::ostream &out)
+    {
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-48s %14s %14s %12s  %s\n", "Benchmark", "Time", "CPU", "Iterations",
+                      "UserCounters...");
+        out << line << std::string(110, '-') << "\n";
+    }
+
+    void writeConsoleRow(std::ostream &out, const Result &r)
+    {
+        char line[256];
+        std::snprintf(line, sizeof(line), "%-48s %11.1f ns %11.1f ns %12llu ", r.benchmark->name.c_str(), r.real_ns,
+                      r.cpu_ns, (unsigned long long)r.iterations);
+        out << line;
+        if (r.items_per_second > 0)
+        {
+            std::snprintf(line, sizeof(line), " items_per_second=%.4gM/s", r.items_per_second / 1e6);
+            out << line;
+        }
+        for (const auto &counter : r.counters)
+        {
+            std::snprintf(line, sizeof(line), " %s=%.4g", counter.first.c_str(), counter.second);
+            out << line;
+        }
+        out << std::endl;
+    }
+
+    // Accepts --flag=value and --flag value
+    bool flagValue(int argc, char **argv, int &i, const char *flag, std::string &value)
+    {
+        size_t length = std::strlen(flag);
+        if (std::strncmp(argv[i], flag, length) != 0)
+            return false;
+        if (argv[i][length] == '=')
+        {
+            value = argv[i] + length + 1;
+            return true;
+        }
+        if (argv[i][length] == '\0' && i + 1 < argc)
+        {
+            value = argv[++i];
+            return true;
+        }
+        return false;
+    }
+
+    void usage(const char *argv0)
+    {
+        std::cerr << "usage: " << argv0 << " [--benchmark_filter=REGEX] [--benchmark_min_time=SECONDS]\n"
+                  << "       [--benchmark_repetitions=N] [--benchmark_format=console|json]\n"
+                  << "       [--benchmark_out=FILE.json] [--benchmark_list_tests]\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string filter = ".*", format = "console", out_path;
+    double min_time_s = 0.5;
+    int repetitions = 1;
+    bool list_only = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string value;
+        if (flagValue(argc, argv, i, "--benchmark_filter", value))
+            filter = value;
+        else if (flagValue(argc, argv, i, "--benchmark_min_time", value))
+            min_time_s = std::atof(value.c_str()); // "0.5" or Google Benchmark's "0.5s"
+        else if (flagValue(argc, argv, i, "--benchmark_repetitions", value))
+            repetitions = std::max(1, std::atoi(value.c_str()));
+        else if (flagValue(argc, argv, i, "--benchmark_format", value) && (value == "console" || value == "json"))
+            format = value;
+        else if (flagValue(argc, argv, i, "--benchmark_out", value))
+            out_path = value;
+        else if (std::strcmp(argv[i], "--benchmark_list_tests") == 0)
+            list_only = true;
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::regex pattern;
+    try
+    {
+        pattern = std::regex(filter);
+    }
+    catch (const std::regex_error &)
+    {
+        std::cerr << "invalid --benchmark_filter: " << filter << "\n";
+        return 2;
+    }
+
+    std::vector<Benchmark> benchmarks = registry();
+    std::vector<const Benchmark *> selected;
+    for (const Benchmark &b : benchmarks)
+    {
+        if (std::regex_search(b.name, pattern))
+            selected.push_back(&b);
+    }
+    if (list_only)
+    {
+        for (const Benchmark *b : selected)
+            std::cout << b->name << "\n";
+        return 0;
+    }
+
+    if (format == "console")
+        writeConsoleHeader(std::cout);
+    std::vector<Result> results;
+    std::map<std::string, int> family_index, instance_count;
+    for (const Benchmark *b : selected)
+    {
+        if (!family_index.count(b->family))
+            family_index.emplace(b->family, (int)family_index.size());
+        int instance = instance_count[b->family]++;
+        for (int rep = 0; rep < repetitions; ++rep)
+        {
+            Result r = runBenchmark(*b, min_time_s);
+            r.family_index = family_index[b->family];
+            r.instance_index = instance;
+            r.repetition = rep;
+            if (format == "console")
+                writeConsoleRow(std::cout, r);
+            results.push_back(std::move(r));
+        }
+    }
+
+    if (format == "json")
+        writeJson(std::cout, results, argv[0], repetitions);
+    std::cout.flush();
+    if (!out_path.empty())
+    {
+        std::ofstream out(out_path);
+        if (!out)
+        {
+            std::cerr << "cannot write " << out_path << "\n";
+            return 1;
+        }
+        writeJson(out, results, argv[0], repetitions);
+    }
+    return 0;
+}
@@ -0,0 +1,339 @@
+// anomsched_scaling: where does Scheduler stop scaling? Runs a fixed amount
+// of CPU-bound work, cut into jobs of 1us, 10us, 100us and 1ms, through
+// pools of 1..N workers and reports speedup, efficiency and scheduler
+// overhead per job:
+//
+//   anomsched_scaling --csv scaling.csv --markdown scaling.md
+//   anomsched_scaling --threads 1,2,4,8 --granularities 1,100 --baseline scaling.csv
+//
+// Jobs burn a calibrated number of loop iterations rather than wall time,
+// so each job is the same work however the OS schedules it. The serial
+// reference runs the same jobs back to back on one thread without a
+// scheduler, so:
+//   speedup      = serial time / pool time
+//   efficiency   = speedup / workers
+//   overhead/job = (pool time x busy cores - serial time) / jobs
+// where busy cores is min(workers, hardware threads), clamped at 0: when
+// the overhead is below timing noise the difference can come out negative.
+//
+// With --baseline, a point fails when its speedup falls more than
+// --tolerance below the baseline CSV's. Exit status: 0 pass, 1 regression,
+// 2 bad arguments, 3 I/O error (unreadable baseline, unwritable report).
+#include "scheduler.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    uint64_t burn(uint64_t iterations)
+    {
+        // A dependent multiply-add chain the optimizer can't fold away
+        volatile uint64_t sink = 0;
+        uint64_t x = 0x9E3779B97F4A7C15ull;
+        for (uint64_t i = 0; i < iterations; ++i)
+            x = x * 6364136223846793005ull + 1442695040888963407ull;
+        sink = x;
+        return sink;
+    }
+
+    double secondsSince(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Loop iterations per microsecond, best of several timings
+    double calibrate()
+    {
+        const uint64_t iterations = 20000000;
+        double best = std::numeric_limits<double>::max();
+        for (int i = 0; i < 5; ++i)
+        {
+            auto start = Clock::now();
+            burn(iterations);
+            best = std::min(best, secondsSince(start));
+        }
+        return iterations / (best * 1e6);
+    }
+
+    std::vector<int> parseList(const std::string &text)
+    {
+        std::vector<int> values;
+        std::stringstream in(text);
+        std::string item;
+        while (std::getline(in, item, ','))
+            values.push_back(std::atoi(item.c_str()));
+        return values;
+    }
+
+    struct Point
+    {
+        int granularity_us = 0;
+        int threads = 0;
+        uint64_t jobs = 0;
+        double serial_s = 0;
+        double pool_s = 0;
+        double speedup = 0;
+        double efficiency = 0;
+        double overhead_ns = 0; // per job
+        double baseline_speedup = 0; // 0 = no baseline point
+        bool failed = false;
+    };
+
+    double serialRun(uint64_t jobs, uint64_t iterations, int repetitions)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (int r = 0; r < repetitions; ++r)
+        {
+            auto start = Clock::now();
+            for (uint64_t j = 0; j < jobs; ++j)
+                burn(iterations);
+            best = std::min(best, secondsSince(start));
+        }
+        return best;
+    }
+
+    // Submit to all-done wall time of one pool, best of repetitions
+    double poolRun(int threads, uint64_t jobs, uint64_t iterations, int repetitions, const std::string &log_path)
+    {
+        SchedulerOptions options;
+        options.print_anomalies = false;
+        options.log_sampling.mode = SamplingMode::OneInN;
+        options.log_sampling.one_in_n = std::numeric_limits<uint32_t>::max();
+        options.log_sampling.keep_anomalies = false;
+
+        double best = std::numeric_limits<double>::max();
+        for (int r = 0; r < repetitions; ++r)
+        {
+            Scheduler scheduler(threads, log_path, options);
+            scheduler.start();
+            std::atomic<uint64_t> done{0};
+            std::promise<void> finished;
+            std::future<void> all_done = finished.get_future();
+            auto start = Clock::now();
+            for (uint64_t j = 0; j < jobs; ++j)
+            {
+                scheduler.submitJob([&, iterations]
+                                    {
+                    burn(iterations);
+                    if (done.fetch_add(1, std::memory_order_acq_rel) + 1 == jobs)
+                        finished.set_value(); });
+            }
+            all_done.wait();
+            best = std::min(best, secondsSince(start));
+            scheduler.stop();
+        }
+        std::error_code ignored;
+        std::filesystem::remove(log_path, ignored);
+        return best;
+    }
+
+    // Granularity,Threads -> Speedup from a CSV this tool wrote
+    bool readBaseline(const std::string &path, std::map<std::pair<int, int>, double> &speedups)
+    {
+        std::ifstream in(path);
+        if (!in)
+            return false;
+        std::string line;
+        std::getline(in, line); // header
+        while (std::getline(in, line))
+        {
+            std::vector<std::string> fields;
+            std::stringstream row(line);
+            std::string field;
+            while (std::getline(row, field, ','))
+                fields.push_back(field);
+            if (fields.size() >= 7)
+                speedups[{std::atoi(fields[0].c_str()), std::atoi(fields[1].c_str())}] = std::atof(fields[5].c_str());
+        }
+        return true;
+    }
+
+    void writeCsv(std::ostream &out, const std::vector<Point> &points)
+    {
+        out << "GranularityUS,Threads,Jobs,SerialS,PoolS,Speedup,Efficiency,OverheadNSPerJob,BaselineSpeedup,Pass\n";
+        for (const Point &p : points)
+        {
+            char line[256];
+            std::snprintf(line, sizeof(line), "%d,%d,%llu,%.6f,%.6f,%.4f,%.4f,%.1f,%.4f,%d\n", p.granularity_us,
+                          p.threads, (unsigned long long)p.jobs, p.serial_s, p.pool_s, p.speedup, p.efficiency,
+                          p.overhead_ns, p.baseline_speedup, p.failed ? 0 : 1);
+            out << line;
+        }
+    }
+
+    void writeMarkdown(std::ostream &out, const std::vector<Point> &points, unsigned cpus, bool with_baseline)
+    {
+        out << "## Scheduler scalability (" << cpus << " hardware threads)\n\n";
+        out << "| Job size | Workers | Jobs | Pool time | Speedup | Efficiency | Overhead/job |"
+            << (with_baseline ? " Baseline | Result |" : "") << "\n";
+        out << "|---:|---:|---:|---:|---:|---:|---:|" << (with_baseline ? "---:|:---|" : "") << "\n";
+        for (const Point &p : points)
+        {
+            char line[256];
+            std::snprintf(line, sizeof(line), "| %d us | %d | %llu | %.1f ms | %.2fx | %.0f%% | %.0f ns |",
+                          p.granularity_us, p.threads, (unsigned long long)p.jobs, p.pool_s * 1e3, p.speedup,
+                          p.efficiency * 100, p.overhead_ns);
+            out << line;
+            if (with_baseline)
+            {
+                if (p.baseline_speedup > 0)
+                    std::snprintf(line, sizeof(line), " %.2fx | %s |", p.baseline_speedup, p.failed ? "FAIL" : "pass");
+                else
+                    std::snprintf(line, sizeof(line), " - | new |");
+                out << line;
+            }
+            out << "\n";
+        }
+    }
+
+    void usage(const char *argv0)
+    {
+        std::cerr << "usage: " << argv0 << " [options]\n"
+                  << "  --threads N,N,...        worker counts (default 1,2,4,... up to the hardware threads)\n"
+                  << "  --granularities US,...   job sizes in microseconds (default 1,10,100,1000)\n"
+                  << "  --work-ms MS             serial work per job size (default 200)\n"
+                  << "  --repetitions N          best of N runs per point (default 3)\n"
+                  << "  --csv FILE               write the results as CSV (usable as a baseline)\n"
+                  << "  --markdown FILE          write the markdown report to FILE\n"
+                  << "  --baseline FILE          compare speedups with an earlier --csv\n"
+                  << "  --tolerance FRACTION     allowed relative speedup loss (default 0.10)\n"
+                  << "exit status: 0 pass, 1 speedup regression, 2 bad arguments, 3 I/O error\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int> thread_counts;
+    for (unsigned t = 1; t < cpus; t *= 2)
+        thread_counts.push_back(int(t));
+    thread_counts.push_back(int(cpus));
+    std::vector<int> granularities{1, 10, 100, 1000};
+    double work_ms = 200;
+    int repetitions = 3;
+    double tolerance = 0.10;
+    std::string csv_path, markdown_path, baseline_path;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "--threads")
+        {
+            thread_counts = parseList(value);
+            ok = !thread_counts.empty() && *std::min_element(thread_counts.begin(), thread_counts.end()) > 0;
+        }
+        else if (arg == "--granularities")
+        {
+            granularities = parseList(value);
+            ok = !granularities.empty() && *std::min_element(granularities.begin(), granularities.end()) > 0;
+        }
+        else if (arg == "--work-ms")
+            ok = (work_ms = std::atof(value.c_str())) > 0;
+        else if (arg == "--repetitions")
+            ok = (repetitions = std::atoi(value.c_str())) > 0;
+        else if (arg == "--csv")
+            csv_path = value;
+        else if (arg == "--markdown")
+            markdown_path = value;
+        else if (arg == "--baseline")
+            baseline_path = value;
+        else if (arg == "--tolerance")
+            ok = (tolerance = std::atof(value.c_str())) >= 0;
+        else
+            ok = false;
+        if (!ok)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    std::map<std::pair<int, int>, double> baseline;
+    if (!baseline_path.empty() && !readBaseline(baseline_path, baseline))
+    {
+        std::cerr << argv[0] << ": cannot read baseline " << baseline_path << "\n";
+        return 3;
+    }
+
+    std::string log_path = (std::filesystem::temp_directory_path() / "anomsched_scaling.bin").string();
+
+    double iterations_per_us = calibrate();
+    std::vector<Point> points;
+    bool failed = false;
+    for (int granularity : granularities)
+    {
+        uint64_t iterations = uint64_t(iterations_per_us * granularity);
+        uint64_t jobs = std::max<uint64_t>(1, uint64_t(work_ms * 1000 / granularity));
+        double serial_s = serialRun(jobs, iterations, repetitions);
+        for (int threads : thread_counts)
+        {
+            Point p;
+            p.granularity_us = granularity;
+            p.threads = threads;
+            p.jobs = jobs;
+            p.serial_s = serial_s;
+            p.pool_s = poolRun(threads, jobs, iterations, repetitions, log_path);
+            p.speedup = serial_s / p.pool_s;
+            p.efficiency = p.speedup / threads;
+            p.overhead_ns = std::max(0.0, (p.pool_s * std::min<unsigned>(threads, cpus) - serial_s) * 1e9 / jobs);
+            auto base = baseline.find({granularity, threads});
+            if (base != baseline.end())
+            {
+                p.baseline_speedup = base->second;
+                p.failed = p.speedup < base->second * (1 - tolerance);
+                failed = failed || p.failed;
+            }
+            points.push_back(p);
+        }
+    }
+
+    writeMarkdown(std::cout, points, cpus, !baseline.empty());
+    if (!baseline.empty())
+        std::cout << "\n" << (failed ? "FAIL" : "PASS") << ": speedups against " << baseline_path << " with "
+                  << tolerance * 100 << "% tolerance\n";
+    std::cout.flush();
+
+    if (!markdown_path.empty())
+    {
+        std::ofstream md(markdown_path);
+        writeMarkdown(md, points, cpus, !baseline.empty());
+        if (!md)
+        {
+            std::cerr << argv[0] << ": error writing " << markdown_path << "\n";
+            return 3;
+        }
+    }
+    if (!csv_path.empty())
+    {
+        std::ofstream csv(csv_path);
+        writeCsv(csv, points);
+        if (!csv)
+        {
+            std::cerr << argv[0] << ": error writing " << csv_path << "\n";
+            return 3;
+        }
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,152 @@
+#include "alloc_tracker.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(ANOMSCHED_ALLOC_TRACKER) && (defined(__GLIBC__) || defined(__APPLE__) || defined(_WIN32))
+#define ANOMSCHED_ALLOC_HOOKS 1
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#else
+#include <malloc.h>
+#endif
+#endif
+
+namespace
+{
+    // Constant-initialized, so the hooks touch them without TLS guards
+    thread_local bool tracking = false;
+    thread_local uint64_t bytes = 0;
+    thread_local uint64_t allocations = 0;
+    thread_local int64_t live = 0; // may go negative when freeing older blocks
+    thread_local int64_t peak = 0;
+}
+
+#ifdef ANOMSCHED_ALLOC_HOOKS
+
+namespace
+{
+    inline size_t usableSize(void *p)
+    {
+#if defined(__APPLE__)
+        return malloc_size(p);
+#elif defined(_WIN32)
+        return _msize(p);
+#else
+        return malloc_usable_size(p);
+#endif
+    }
+
+    // Follows the standard operator new: retry through the new_handler
+    void *allocate(size_t size)
+    {
+        if (size == 0)
+            size = 1;
+        void *p;
+        while ((p = std::malloc(size)) == nullptr)
+        {
+            std::new_handler handler = std::get_new_handler();
+            if (!handler)
+                return nullptr;
+            handler();
+        }
+        if (tracking)
+        {
+            int64_t size_used = (int64_t)usableSize(p);
+            bytes += size_used;
+            ++allocations;
+            live += size_used;
+            if (live > peak)
+                peak = live;
+        }
+        return p;
+    }
+
+    void release(void *p) noexcept
+    {
+        if (tracking && p)
+            live -= (int64_t)usableSize(p);
+        std::free(p);
+    }
+
+    void *allocateOrThrow(size_t size)
+    {
+        void *p = allocate(size);
+        if (!p)
+            throw std::bad_alloc();
+        return p;
+    }
+
+    void *allocateNothrow(size_t size) noexcept
+    {
+        try
+        {
+            return allocate(size);
+        }
+        catch (...)
+        {
+            return nullptr;
+        }
+    }
+}
+
+void *operator new(size_t size) { return allocateOrThrow(size); }
+void *operator new[](size_t size) { return allocateOrThrow(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept { return allocateNothrow(size); }
+void *operator new[](size_t size, const std::nothrow_t &) noexcept { return allocateNothrow(size); }
+void operator delete(void *p) noexcept { release(p); }
+void operator delete[](void *p) noexcept { release(p); }
+void operator delete(void *p, size_t) noexcept { release(p); }
+void operator delete[](void *p, size_t) noexcept { release(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept { release(p); }
+void operator delete[](void *p, const std::nothrow_t &) noexcept { release(p); }
+
+bool allocTrackingSupported()
+{
+    return true;
+}
+
+#else
+
+bool allocTrackingSupported()
+{
+    return false;
+}
+
+#endif
+
+void AllocScope::begin()
+{
+    outer_active = tracking;
+    outer_bytes = bytes;
+    outer_allocations = allocations;
+    outer_live = live;
+    outer_peak = peak;
+    bytes = allocations = 0;
+    live = peak = 0;
+    tracking = true;
+}
+
+AllocStats AllocScope::end()
+{
+    AllocStats stats;
+    stats.bytes = bytes;
+    stats.allocations = allocations;
+    stats.peak_bytes = (uint64_t)peak;
+
+    // Fold this scope into the enclosing one as if it had never been split
+    if (outer_active)
+    {
+        outer_peak = std::max(outer_peak, outer_live + peak);
+        outer_live += live;
+        outer_bytes += bytes;
+        outer_allocations += allocations;
+    }
+    bytes = outer_bytes;
+    allocations = outer_allocations;
+    live = outer_live;
+    peak = outer_peak;
+    tracking = outer_active;
+    return stats;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+
+// ------------------- Allocation Tracking ---------------------
+// Replacements for the global operator new/delete that count heap use in
+// thread-local counters, but only while an AllocScope is open on the
+// thread; elsewhere each call costs one well-predicted branch. Sizes are
+// what the allocator actually reserved (malloc_usable_size), so a block
+// is credited back exactly when it is freed.
+//
+// Built in with the ANOMSCHED_ALLOC_TRACKER CMake option (on by default)
+// on glibc, macOS and Windows. Aligned (align_val_t) allocations keep the
+// standard library's operators and are not counted.
+struct AllocStats
+{
+    uint64_t bytes = 0;       // allocated inside the scope
+    uint64_t allocations = 0; // operator new calls inside the scope
+    uint64_t peak_bytes = 0;  // high-water mark of bytes live from the scope's start
+};
+
+// False if the hooks are not compiled into this build
+bool allocTrackingSupported();
+
+// Attributes the calling thread's allocations to one job. Scopes nest: an
+// inner scope's allocations also count towards the scope around it.
+class AllocScope
+{
+public:
+    void begin();
+    AllocStats end();
+
+private:
+    bool outer_active = false;
+    uint64_t outer_bytes = 0;
+    uint64_t outer_allocations = 0;
+    int64_t outer_live = 0;
+    int64_t outer_peak = 0;
+};
@@ -0,0 +1,282 @@
+#include "anomaly_detector.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include <random>
+
+bool ZScoreDetector::observe(double duration_ms)
+{
+    bool anomaly = false;
+    if (history.size() >= warmup)
+    {
+        double mean = std::accumulate(history.begin(), history.end(), 0.0) / history.size();
+        double variance = 0.0;
+        for (double d : history)
+            variance += (d - mean) * (d - mean);
+        variance /= history.size();
+        double std_dev = std::max(std::sqrt(variance), min_std_ms);
+        anomaly = std::abs(duration_ms - mean) / std_dev > threshold;
+    }
+
+    history.push_back(duration_ms);
+    if (history.size() > window)
+        history.pop_front();
+    return anomaly;
+}
+
+// ------------------- P² Quantile ---------------------
+
+P2Quantile::P2Quantile(double p_) : p(p_)
+{
+    increments[0] = 0;
+    increments[1] = p / 2;
+    increments[2] = p;
+    increments[3] = (1 + p) / 2;
+    increments[4] = 1;
+}
+
+void P2Quantile::add(double x)
+{
+    // The first five observations seed the markers
+    if (n < 5)
+    {
+        heights[n++] = x;
+        if (n == 5)
+        {
+            std::sort(heights, heights + 5);
+            for (int i = 0; i < 5; ++i)
+            {
+                positions[i] = i + 1;
+                desired[i] = 1 + 4 * increments[i];
+            }
+        }
+        return;
+    }
+    ++n;
+
+    int k;
+    if (x < heights[0])
+    {
+        heights[0] = x;
+        k = 0;
+    }
+    else if (x >= heights[4])
+    {
+        heights[4] = x;
+        k = 3;
+    }
+    else
+    {
+        k = 0;
+        while (k < 3 && x >= heights[k + 1])
+            ++k;
+    }
+    for (int i = k + 1; i < 5; ++i)
+        positions[i] += 1;
+    for (int i = 0; i < 5; ++i)
+        desired[i] += increments[i];
+
+    // Move the middle markers towards their desired positions
+    for (int i = 1; i <= 3; ++i)
+    {
+        double d = desired[i] - positions[i];
+        if ((d >= 1 && positions[i + 1] - positions[i] > 1) || (d <= -1 && positions[i - 1] - positions[i] < -1))
+        {
+            double s = d > 0 ? 1.0 : -1.0;
+            double parabolic = heights[i] + s / (positions[i + 1] - positions[i - 1]) *
+                                                ((positions[i] - positions[i - 1] + s) * (heights[i + 1] - heights[i]) /
+                                                     (positions[i + 1] - positions[i]) +
+                                                 (positions[i + 1] - positions[i] - s) * (heights[i] - heights[i - 1]) /
+                                                     (positions[i] - positions[i - 1]));
+            if (heights[i - 1] < parabolic && parabolic < heights[i + 1])
+            {
+                heights[i] = parabolic;
+            }
+            else
+            {
+                int j = i + int(s);
+                heights[i] += s * (heights[j] - heights[i]) / (positions[j] - positions[i]);
+            }
+            positions[i] += s;
+        }
+    }
+}
+
+double P2Quantile::value() const
+{
+    if (n == 0)
+        return 0.0;
+    if (n < 5)
+    {
+        double seen[5];
+        std::copy(heights, heights + n, seen);
+        std::sort(seen, seen + n);
+        return seen[size_t(p * (n - 1) + 0.5)];
+    }
+    return heights[2];
+}
+
+// ------------------- Median / MAD ---------------------
+
+void MedianMadDetector::Estimate::add(double x)
+{
+    median.add(x);
+    deviation.add(std::abs(x - median.value()));
+}
+
+bool MedianMadDetector::observe(double duration_ms)
+{
+    bool anomaly = false;
+    if (current.median.count() >= warmup)
+    {
+        double weight = double(next.median.count()) / generation;
+        double center = (1 - weight) * current.median.value() + weight * next.median.value();
+        double mad = (1 - weight) * current.deviation.value() + weight * next.deviation.value();
+        double scale = std::max(1.4826 * mad, min_scale_ms);
+        anomaly = std::abs(duration_ms - center) / scale > threshold;
+    }
+    current.add(duration_ms);
+    next.add(duration_ms);
+    if (next.median.count() >= generation)
+    {
+        current = next;
+        next = Estimate();
+    }
+    return anomaly;
+}
+
+std::unique_ptr<AnomalyDetector> makeAnomalyDetector(const std::string &name)
+{
+    if (name == "zscore")
+        return std::make_unique<ZScoreDetector>();
+    if (name == "mad")
+        return std::make_unique<MedianMadDetector>();
+    return nullptr;
+}
+
+const std::vector<std::string> &anomalyDetectorNames()
+{
+    static const std::vector<std::string> names{"zscore", "mad"};
+    return names;
+}
+
+// ------------------- Scoring ---------------------
+
+namespace
+{
+    // Logger's view of a job: whole milliseconds, truncated like the CSV
+    double loggedDurationMs(const ExecutionRecord &record)
+    {
+        const int64_t ns_per_ms = 1000000;
+        return double(record.end_ns / ns_per_ms - record.start_ns / ns_per_ms);
+    }
+
+    void tally(DetectorScore &score, const ExecutionRecord &record, bool flagged)
+    {
+        bool injected = record.job_class != 0;
+        score.true_positives += injected && flagged;
+        score.false_positives += !injected && flagged;
+        score.false_negatives += injected && !flagged;
+        score.true_negatives += !injected && !flagged;
+        ++score.class_jobs[record.job_class];
+        score.class_flagged[record.job_class] += flagged;
+    }
+
+    void writeScore(std::ostream &out, const char *name, const DetectorScore &score)
+    {
+        char line[128];
+        std::snprintf(line, sizeof(line), "  %-10s %10.3f %10.3f %8llu %8llu %8llu", name, score.precision(),
+                      score.recall(), (unsigned long long)score.true_positives,
+                      (unsigned long long)score.false_positives, (unsigned long long)score.false_negatives);
+        out << line;
+        for (int c = 1; c < 256; ++c)
+        {
+            if (score.class_jobs[c] == 0)
+                continue;
+            std::snprintf(line, sizeof(line), "  class %d %llu/%llu", c, (unsigned long long)score.class_flagged[c],
+                          (unsigned long long)score.class_jobs[c]);
+            out << line;
+        }
+        out << "\n";
+    }
+}
+
+double DetectorScore::precision() const
+{
+    uint64_t flagged = true_positives + false_positives;
+    return flagged > 0 ? double(true_positives) / flagged : 0.0;
+}
+
+double DetectorScore::recall() const
+{
+    uint64_t injected = true_positives + false_negatives;
+    return injected > 0 ? double(true_positives) / injected : 0.0;
+}
+
+DetectorScore scoreDetector(AnomalyDetector &detector, const std::vector<ExecutionRecord> &records)
+{
+    DetectorScore score;
+    for (const ExecutionRecord &record : records)
+        tally(score, record, detector.observe(loggedDurationMs(record)));
+    return score;
+}
+
+DetectorScore scoreLoggedFlags(const std::vector<ExecutionRecord> &records)
+{
+    DetectorScore score;
+    for (const ExecutionRecord &record : records)
+        tally(score, record, record.is_anomaly);
+    return score;
+}
+
+std::vector<ExecutionRecord> stepChangeRecords(size_t jobs)
+{
+    const int64_t ns_per_ms = 1000000;
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int> jitter(0, 2);
+    std::vector<ExecutionRecord> records;
+    records.reserve(jobs);
+    int64_t clock_ns = 0;
+    for (size_t i = 0; i < jobs; ++i)
+    {
+        ExecutionRecord record;
+        record.job_id = i + 1;
+        int64_t ms = (i < jobs / 2 ? 5 : 20) + jitter(gen);
+        if (i % 50 == 49)
+        {
+            ms *= 10;
+            record.job_class = 1;
+        }
+        record.submit_ns = record.start_ns = clock_ns;
+        record.end_ns = clock_ns + ms * ns_per_ms;
+        clock_ns = record.end_ns;
+        records.push_back(record);
+    }
+    return records;
+}
+
+void writeDetectorScores(std::ostream &out, const std::vector<ExecutionRecord> &records)
+{
+    DetectorScore logged = scoreLoggedFlags(records);
+    out << "Detector scores against injected anomalies (job class != 0, "
+        << logged.true_positives + logged.false_negatives << " of " << records.size() << " jobs)\n";
+    char line[128];
+    std::snprintf(line, sizeof(line), "  %-10s %10s %10s %8s %8s %8s  %s\n", "detector", "precision", "recall", "tp",
+                  "fp", "fn", "flagged/injected by class");
+    out << line;
+    writeScore(out, "as logged", logged);
+    for (const std::string &name : anomalyDetectorNames())
+    {
+        std::unique_ptr<AnomalyDetector> detector = makeAnomalyDetector(name);
+        writeScore(out, detector->name(), scoreDetector(*detector, records));
+    }
+
+    std::vector<ExecutionRecord> step = stepChangeRecords();
+    out << "\nSynthetic step change (" << step.size() << " jobs, ~5 ms -> ~20 ms halfway, every 50th a 10x spike)\n";
+    for (const std::string &name : anomalyDetectorNames())
+    {
+        std::unique_ptr<AnomalyDetector> detector = makeAnomalyDetector(name);
+        writeScore(out, detector->name(), scoreDetector(*detector, step));
+    }
+}
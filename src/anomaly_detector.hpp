@@ -0,0 +1,144 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "log_format.hpp"
+
+// ------------------- Real-Time Anomaly Detectors ---------------------
+// Logger asks its detector about every job's execution time (whole
+// milliseconds, as logged), in completion order and under the log lock.
+// Plug in a different one with SchedulerOptions::anomaly_detector or
+// Logger::setDetector().
+
+class AnomalyDetector
+{
+public:
+    virtual ~AnomalyDetector() = default;
+
+    // Judges duration_ms against the jobs seen so far, then adds it to them
+    virtual bool observe(double duration_ms) = 0;
+
+    virtual const char *name() const = 0;
+};
+
+// Mean and standard deviation of the last `window` jobs, z > threshold.
+// One large outlier inflates the deviation and masks the next ones; the
+// default detector, kept for continuity. The deviation never drops below
+// min_std_ms, the log's resolution: sub-millisecond jobs that happen to
+// cross a millisecond boundary are not outliers.
+class ZScoreDetector : public AnomalyDetector
+{
+public:
+    explicit ZScoreDetector(size_t window_ = 50, double threshold_ = 2.0, size_t warmup_ = 10,
+                            double min_std_ms_ = 1.0)
+        : window(window_), threshold(threshold_), warmup(warmup_), min_std_ms(min_std_ms_) {}
+
+    bool observe(double duration_ms) override;
+    const char *name() const override { return "zscore"; }
+
+private:
+    std::deque<double> history;
+    size_t window;
+    double threshold;
+    size_t warmup;
+    double min_std_ms;
+};
+
+// Streaming estimate of one quantile in O(1) time and space, with the P²
+// algorithm (Jain & Chlamtac, 1985): five markers whose heights are nudged
+// along a parabola as observations arrive.
+class P2Quantile
+{
+public:
+    explicit P2Quantile(double p = 0.5);
+
+    void add(double x);
+    double value() const;
+    uint64_t count() const { return n; }
+
+private:
+    double p;
+    uint64_t n = 0;
+    double heights[5];
+    double positions[5];
+    double desired[5];
+    double increments[5];
+};
+
+// Modified z-score over the median and the median absolute deviation
+// (Iglewicz & Hoaglin): |x - median| / (1.4826 MAD) > threshold. Both
+// are P² estimates, so a burst of outliers barely moves them. Estimates
+// are restarted every `generation` jobs so the detector follows a step
+// change in the workload: the previous generation answers while the next
+// one fills, blended in proportion to how full the next one is. The scale
+// never drops below min_scale_ms, since a zero MAD just means most
+// durations round to the same millisecond.
+class MedianMadDetector : public AnomalyDetector
+{
+public:
+    explicit MedianMadDetector(double threshold_ = 3.5, double min_scale_ms_ = 1.0, size_t warmup_ = 10,
+                               size_t generation_ = 50)
+        : threshold(threshold_), min_scale_ms(min_scale_ms_), warmup(warmup_),
+          generation(std::max<size_t>(generation_, 1)) {}
+
+    bool observe(double duration_ms) override;
+    const char *name() const override { return "mad"; }
+
+private:
+    struct Estimate
+    {
+        P2Quantile median{0.5};
+        P2Quantile deviation{0.5}; // of |x - running median|
+
+        void add(double x);
+    };
+
+    Estimate current; // answers; holds the last one to two generations
+    Estimate next;    // fills up and replaces current after `generation` jobs
+    double threshold;
+    double min_scale_ms;
+    size_t warmup;
+    size_t generation;
+};
+
+// "zscore" or "mad" with default settings; null for other names
+std::unique_ptr<AnomalyDetector> makeAnomalyDetector(const std::string &name);
+const std::vector<std::string> &anomalyDetectorNames();
+
+// ------------------- Detector Scoring ---------------------
+// Replays the execution times of a log through a detector and scores its
+// verdicts against injected anomalies, i.e. jobs with a nonzero job_class
+// (advancedStressTest tags its CPU, memory, I/O and contention jobs 1-4).
+
+struct DetectorScore
+{
+    uint64_t true_positives = 0;
+    uint64_t false_positives = 0;
+    uint64_t false_negatives = 0;
+    uint64_t true_negatives = 0;
+    uint64_t class_jobs[256] = {};    // jobs per job_class
+    uint64_t class_flagged[256] = {}; // of which flagged
+
+    double precision() const;
+    double recall() const;
+};
+
+// Records in log (completion) order
+DetectorScore scoreDetector(AnomalyDetector &detector, const std::vector<ExecutionRecord> &records);
+// The log's own IsAnomaly flags, scored the same way
+DetectorScore scoreLoggedFlags(const std::vector<ExecutionRecord> &records);
+
+// Synthetic jobs of about 5 ms that step to about 20 ms halfway through,
+// with every 50th job a tenfold spike tagged job_class 1. A detector that
+// never forgets the first level flags the whole second half.
+std::vector<ExecutionRecord> stepChangeRecords(size_t jobs = 2000);
+
+// Precision, recall and per-class recall of the logged flags and of every
+// built-in detector replayed over records, then of every detector over
+// stepChangeRecords()
+void writeDetectorScores(std::ostream &out, const std::vector<ExecutionRecord> &records);
@@ -1,21 +1,103 @@
 #pragma once
 #include <functional>
 #include <chrono>
+#include <cstdint>
+#include <optional>
+#include <atomic>
 
-struct Job {
-    int id;
-    int priority;  // higher = higher priority
+struct Job
+{
+    uint64_t id;
+    int priority; // higher = higher priority
     std::function<void()> task;
     std::chrono::high_resolution_clock::time_point submit_time;
+    std::optional<uint64_t> affinity_key;
+    int preferred_worker = -1; // -1 = no affinity
+    uint8_t job_class = 0;     // see JobOptions::job_class
 
-    Job(int id_, int prio, std::function<void()> t)
-        : id(id_), priority(prio), task(std::move(t)),
-          submit_time(std::chrono::high_resolution_clock::now()) {}
+    // Default constructor
+    Job() : id(0), priority(0), task([] {}), submit_time(std::chrono::high_resolution_clock::now()) {}
+
+    // Parameterized constructor
+    Job(uint64_t id_, int prio, std::function<void()> t)
+        : id(id_), priority(prio), task(std::move(t)), submit_time(std::chrono::high_resolution_clock::now()) {}
+
+    // For priority queue comparison (higher priority = run first)
+    bool operator<(const Job &other) const
+    {
+        return priority < other.priority;
+    }
+};
+
+// Per-submission hints; all fields default to "no hint"
+struct JobOptions
+{
+    bool tiny = false; // trivially short: run inline instead of queueing
+
+    // Jobs sharing a key (shard, cache key, ...) are routed to the worker
+    // that last ran that key so its data is still warm in that core's cache.
+    // Jobs run inline or by CallerRuns are not routed and log no affinity.
+    std::optional<uint64_t> affinity_key;
+
+    // Caller-defined category (workload type, injected anomaly kind, ...)
+    // carried into the log and traces; 0 = unclassified
+    uint8_t job_class = 0;
+
+    // When an open-loop client was scheduled to send this job. Queue wait is
+    // then measured from the schedule instead of from the submit call, so a
+    // producer that falls behind (or blocks on a full queue) can't hide the
+    // delay its clients would have seen (coordinated omission).
+    std::optional<std::chrono::high_resolution_clock::time_point> intended_time;
 };
 
 // Comparator for priority queue (max-heap by priority)
-struct JobComparator {
-    bool operator()(const Job& a, const Job& b) {
+struct JobComparator
+{
+    bool operator()(const Job &a, const Job &b)
+    {
         return a.priority < b.priority; // higher priority first
     }
 };
+
+// ------------------- Job ID Allocation ---------------------
+// Hands out 64-bit job IDs in per-thread blocks carved from one shared
+// counter, so producers touch the shared cache line once per kBlockSize
+// submissions. IDs are unique per allocator and increase monotonically
+// within each producer thread, but are not globally ordered across threads.
+class JobIdAllocator
+{
+public:
+    static constexpr uint64_t kBlockSize = 1024;
+
+    uint64_t next()
+    {
+        // One cached block per thread; switching between allocators on the
+        // same thread just claims a fresh block
+        struct Block
+        {
+            uint64_t owner = 0;
+            uint64_t next = 0;
+            uint64_t end = 0;
+        };
+        thread_local Block block;
+
+        if (block.owner != instance_id || block.next == block.end)
+        {
+            uint64_t start = next_block.fetch_add(kBlockSize, std::memory_order_relaxed);
+            block.owner = instance_id;
+            block.next = start;
+            block.end = start + kBlockSize;
+        }
+        return block.next++;
+    }
+
+private:
+    static uint64_t newInstanceId()
+    {
+        static std::atomic<uint64_t> instances{0};
+        return ++instances;
+    }
+
+    const uint64_t instance_id = newInstanceId();
+    alignas(64) std::atomic<uint64_t> next_block{1}; // ID 0 is never handed out
+};
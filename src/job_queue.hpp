@@ -0,0 +1,83 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "job.hpp"
+
+// ------------------- Job Queue ---------------------
+// Max-heap of jobs ordered by priority, FIFO among equal priorities.
+// Unlike std::priority_queue it can also evict its lowest-priority entry,
+// which the shed-lowest overflow policy needs. Not thread-safe; callers
+// hold the scheduler's queue_mutex.
+class JobQueue
+{
+public:
+    bool empty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+
+    const Job &top() const { return heap.front().job; }
+
+    void push(Job job)
+    {
+        heap.push_back(Entry{std::move(job), next_seq++});
+        std::push_heap(heap.begin(), heap.end(), Before());
+    }
+
+    Job pop()
+    {
+        std::pop_heap(heap.begin(), heap.end(), Before());
+        Job job = std::move(heap.back().job);
+        heap.pop_back();
+        return job;
+    }
+
+    // Priority of the entry evictLowest() would remove. Queue must be non-empty.
+    int lowestPriority() const
+    {
+        return lowest()->job.priority;
+    }
+
+    // Removes the lowest-priority entry (newest first among ties). O(n),
+    // only used on the overflow path.
+    Job evictLowest()
+    {
+        auto it = lowest();
+        Job job = std::move(it->job);
+        *it = std::move(heap.back());
+        heap.pop_back();
+        std::make_heap(heap.begin(), heap.end(), Before());
+        return job;
+    }
+
+private:
+    struct Entry
+    {
+        Job job;
+        uint64_t seq;
+    };
+
+    // Heap "less than": lower priority, or same priority but submitted later.
+    struct Before
+    {
+        bool operator()(const Entry &a, const Entry &b) const
+        {
+            if (a.job.priority != b.job.priority)
+                return a.job.priority < b.job.priority;
+            return a.seq > b.seq;
+        }
+    };
+
+    std::vector<Entry>::iterator lowest()
+    {
+        return std::min_element(heap.begin(), heap.end(), Before());
+    }
+
+    std::vector<Entry>::const_iterator lowest() const
+    {
+        return std::min_element(heap.begin(), heap.end(), Before());
+    }
+
+    std::vector<Entry> heap;
+    uint64_t next_seq = 0;
+};
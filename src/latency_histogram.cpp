@@ -0,0 +1,120 @@
+#include "latency_histogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    constexpr uint64_t kSubBuckets = uint64_t(1) << LatencyHistogram::kSubBucketBits;
+
+    inline int highestBit(uint64_t v)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63 - __builtin_clzll(v);
+#else
+        int bit = 0;
+        while (v >>= 1)
+            ++bit;
+        return bit;
+#endif
+    }
+}
+
+LatencyHistogram::LatencyHistogram() : counts(kBuckets) {}
+
+size_t LatencyHistogram::bucketOf(uint64_t ns)
+{
+    const uint64_t limit = (uint64_t(1) << kMaxBits) - 1;
+    if (ns > limit)
+        ns = limit;
+    if (ns < kSubBuckets)
+        return (size_t)ns;
+    int shift = highestBit(ns) - kSubBucketBits;
+    return (size_t(shift + 1) << kSubBucketBits) + (size_t)((ns >> shift) - kSubBuckets);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t bucket)
+{
+    if (bucket < kSubBuckets)
+        return bucket;
+    int shift = (int)(bucket >> kSubBucketBits) - 1;
+    uint64_t mantissa = (bucket & (kSubBuckets - 1)) + kSubBuckets;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+void LatencyHistogram::recordCorrected(int64_t ns, int64_t expected_interval_ns)
+{
+    record(ns);
+    if (expected_interval_ns <= 0)
+        return;
+    for (int64_t missed = ns - expected_interval_ns; missed >= expected_interval_ns; missed -= expected_interval_ns)
+        record(missed);
+}
+
+HistogramSnapshot LatencyHistogram::snapshot() const
+{
+    HistogramSnapshot snap;
+    snap.counts.resize(kBuckets);
+    for (size_t i = 0; i < kBuckets; ++i)
+    {
+        snap.counts[i] = counts[i].load(std::memory_order_relaxed);
+        snap.count += snap.counts[i];
+    }
+    snap.sum_ns = sum_ns.load(std::memory_order_relaxed);
+    snap.max_ns = max_ns.load(std::memory_order_relaxed);
+    if (snap.count == 0)
+        snap.counts.clear();
+    return snap;
+}
+
+void HistogramSnapshot::merge(const HistogramSnapshot &other)
+{
+    if (other.count == 0)
+        return;
+    if (counts.empty())
+        counts.resize(LatencyHistogram::kBuckets);
+    for (size_t i = 0; i < other.counts.size(); ++i)
+        counts[i] += other.counts[i];
+    count += other.count;
+    sum_ns += other.sum_ns;
+    max_ns = std::max(max_ns, other.max_ns);
+}
+
+uint64_t HistogramSnapshot::valueAtQuantile(double q) const
+{
+    if (count == 0)
+        return 0;
+    uint64_t rank = (uint64_t)std::ceil(std::min(std::max(q, 0.0), 1.0) * count);
+    if (rank == 0)
+        rank = 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+            return std::min(LatencyHistogram::bucketUpperBound(i), max_ns);
+    }
+    return max_ns;
+}
+
+uint64_t HistogramSnapshot::countAtOrBelow(uint64_t ns) const
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < counts.size() && LatencyHistogram::bucketUpperBound(i) <= ns; ++i)
+        total += counts[i];
+    return total;
+}
+
+LatencyStats HistogramSnapshot::stats() const
+{
+    const double ns_per_us = 1000.0;
+    LatencyStats s;
+    s.count = count;
+    if (count == 0)
+        return s;
+    s.mean_us = double(sum_ns) / count / ns_per_us;
+    s.p50_us = valueAtQuantile(0.50) / ns_per_us;
+    s.p99_us = valueAtQuantile(0.99) / ns_per_us;
+    s.p999_us = valueAtQuantile(0.999) / ns_per_us;
+    s.max_us = max_ns / ns_per_us;
+    return s;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ------------------- Latency Histograms ---------------------
+// HDR-style log-linear histogram of nanosecond latencies. Values below
+// 2^kSubBucketBits ns get their own bucket; above that every power of two
+// is split into 2^kSubBucketBits linear sub-buckets, so any recorded value
+// is reported within 1/64 (~1.6%) of itself. Values are clamped to
+// 2^kMaxBits ns (~18 minutes).
+//
+// record() is a couple of relaxed atomic adds, safe from any thread;
+// snapshot() copies the counters without stopping writers, so a snapshot
+// taken under load may be off by the few jobs recorded while copying.
+
+struct LatencyStats
+{
+    uint64_t count = 0;
+    double mean_us = 0.0;
+    double p50_us = 0.0;
+    double p99_us = 0.0;
+    double p999_us = 0.0;
+    double max_us = 0.0;
+};
+
+struct HistogramSnapshot
+{
+    std::vector<uint64_t> counts; // per bucket; empty if nothing was recorded
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+    uint64_t max_ns = 0;
+
+    void merge(const HistogramSnapshot &other);
+
+    // Highest value equivalent to the q-quantile's bucket, capped at max_ns
+    uint64_t valueAtQuantile(double q) const;
+    // Values recorded in buckets lying entirely at or below ns
+    uint64_t countAtOrBelow(uint64_t ns) const;
+    LatencyStats stats() const;
+};
+
+class LatencyHistogram
+{
+public:
+    static constexpr int kSubBucketBits = 6;
+    static constexpr int kMaxBits = 40;
+    static constexpr size_t kBuckets = size_t(kMaxBits - kSubBucketBits + 1) << kSubBucketBits;
+
+    LatencyHistogram();
+
+    void record(int64_t ns)
+    {
+        uint64_t v = ns < 0 ? 0 : (uint64_t)ns;
+        counts[bucketOf(v)].fetch_add(1, std::memory_order_relaxed);
+        sum_ns.fetch_add(v, std::memory_order_relaxed);
+        uint64_t seen = max_ns.load(std::memory_order_relaxed);
+        while (v > seen && !max_ns.compare_exchange_weak(seen, v, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    // HdrHistogram's coordinated-omission correction for a client that sends
+    // every expected_interval_ns but waited ns for this reply: also records
+    // the latencies of the requests it would have sent meanwhile (ns minus
+    // each multiple of the interval). No-op correction when interval <= 0.
+    void recordCorrected(int64_t ns, int64_t expected_interval_ns);
+
+    HistogramSnapshot snapshot() const;
+
+    static size_t bucketOf(uint64_t ns);
+    static uint64_t bucketUpperBound(size_t bucket); // largest value mapped to bucket
+
+private:
+    std::vector<std::atomic<uint64_t>> counts;
+    std::atomic<uint64_t> sum_ns{0};
+    std::atomic<uint64_t> max_ns{0};
+};
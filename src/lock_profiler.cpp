@@ -0,0 +1,178 @@
+#include "lock_profiler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <unordered_map>
+
+namespace
+{
+    using anomsched::LockContention;
+
+    // One per thread that ever blocked on an anomsched::mutex. The guard is
+    // only contended while a report is being merged.
+    struct ThreadLockBuffer
+    {
+        std::mutex guard;
+        std::unordered_map<const void *, LockContention> locks;
+    };
+
+    // Buffers outlive their threads so a report still sees finished workers
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadLockBuffer>> buffers;
+    };
+
+    Registry &registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    ThreadLockBuffer &threadBuffer()
+    {
+        thread_local std::shared_ptr<ThreadLockBuffer> buffer = []
+        {
+            auto created = std::make_shared<ThreadLockBuffer>();
+            Registry &r = registry();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            r.buffers.push_back(created);
+            return created;
+        }();
+        return *buffer;
+    }
+
+    thread_local anomsched::LockWaitStats job_waits;
+
+    void merge(LockContention &into, const LockContention &from)
+    {
+        into.waits += from.waits;
+        into.total_wait_ns += from.total_wait_ns;
+        if (from.max_wait_ns > into.max_wait_ns)
+        {
+            into.max_wait_ns = from.max_wait_ns;
+            into.max_wait_job = from.max_wait_job;
+            into.max_wait_holder = from.max_wait_holder;
+        }
+    }
+}
+
+namespace anomsched
+{
+    void mutex::lockContended()
+    {
+        uint64_t holding_job = holder.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        m.lock();
+        int64_t wait_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+
+        job_waits.wait_ns += wait_ns;
+        ++job_waits.waits;
+
+        ThreadLockBuffer &buffer = threadBuffer();
+        std::lock_guard<std::mutex> lock(buffer.guard);
+        LockContention &entry = buffer.locks[this];
+        if (entry.waits == 0)
+        {
+            entry.lock = this;
+            if (name_)
+            {
+                entry.name = name_;
+            }
+            else
+            {
+                char label[32];
+                std::snprintf(label, sizeof(label), "lock@%p", (const void *)this);
+                entry.name = label;
+            }
+        }
+        merge(entry, LockContention{this, std::string(), 1, wait_ns, wait_ns, detail::current_job, holding_job});
+    }
+
+    void LockWaitScope::begin(uint64_t job_id)
+    {
+        outer_job = detail::current_job;
+        outer = job_waits;
+        detail::current_job = job_id;
+        job_waits = LockWaitStats();
+    }
+
+    LockWaitStats LockWaitScope::end()
+    {
+        LockWaitStats stats = job_waits;
+        detail::current_job = outer_job;
+        job_waits.wait_ns = outer.wait_ns + stats.wait_ns;
+        job_waits.waits = outer.waits + stats.waits;
+        return stats;
+    }
+
+    std::vector<LockContention> lockContentionReport(size_t top)
+    {
+        std::unordered_map<const void *, LockContention> merged;
+        Registry &r = registry();
+        {
+            std::lock_guard<std::mutex> registry_lock(r.mutex);
+            for (const auto &buffer : r.buffers)
+            {
+                std::lock_guard<std::mutex> lock(buffer->guard);
+                for (const auto &entry : buffer->locks)
+                {
+                    LockContention &into = merged[entry.first];
+                    if (into.waits == 0)
+                    {
+                        into.lock = entry.second.lock;
+                        into.name = entry.second.name;
+                    }
+                    merge(into, entry.second);
+                }
+            }
+        }
+
+        std::vector<LockContention> report;
+        report.reserve(merged.size());
+        for (auto &entry : merged)
+            report.push_back(std::move(entry.second));
+        std::sort(report.begin(), report.end(), [](const LockContention &a, const LockContention &b)
+                  { return a.total_wait_ns > b.total_wait_ns; });
+        if (top > 0 && report.size() > top)
+            report.resize(top);
+        return report;
+    }
+
+    void writeContentionReport(std::ostream &out, size_t top)
+    {
+        std::vector<LockContention> report = lockContentionReport(top);
+        out << "Lock contention (top " << report.size() << " by total wait)\n";
+        if (report.empty())
+        {
+            out << "  no contended anomsched::mutex\n";
+            return;
+        }
+        char line[256];
+        std::snprintf(line, sizeof(line), "  %-24s %10s %14s %12s %12s  %s\n",
+                      "lock", "waits", "total ms", "mean us", "max us", "longest wait");
+        out << line;
+        for (const LockContention &c : report)
+        {
+            std::snprintf(line, sizeof(line), "  %-24s %10llu %14.3f %12.1f %12.1f  job %llu behind job %llu\n",
+                          c.name.c_str(), (unsigned long long)c.waits, c.total_wait_ns / 1e6,
+                          c.total_wait_ns / 1e3 / c.waits, c.max_wait_ns / 1e3,
+                          (unsigned long long)c.max_wait_job, (unsigned long long)c.max_wait_holder);
+            out << line;
+        }
+    }
+
+    void resetLockContention()
+    {
+        Registry &r = registry();
+        std::lock_guard<std::mutex> registry_lock(r.mutex);
+        for (const auto &buffer : r.buffers)
+        {
+            std::lock_guard<std::mutex> lock(buffer->guard);
+            buffer->locks.clear();
+        }
+    }
+}
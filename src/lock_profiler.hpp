@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// ------------------- Lock Contention Profiling ---------------------
+// anomsched::mutex is a drop-in std::mutex for user jobs that records who
+// waits on it. Uncontended lock() is a try_lock plus one relaxed store of
+// the holder's job ID; only a thread that has to block takes timestamps
+// and appends the wait to its own buffer. The scheduler charges each
+// job the time it spent blocked (LockWaitScope), and
+// lockContentionReport() merges every thread's buffer into the most
+// contended locks.
+//
+//   static anomsched::mutex cache_mutex("cache");
+//   std::lock_guard<anomsched::mutex> lock(cache_mutex);
+namespace anomsched
+{
+    namespace detail
+    {
+        // Job running on this thread, 0 outside jobs; set by LockWaitScope
+        inline thread_local uint64_t current_job = 0;
+    }
+
+    class mutex
+    {
+    public:
+        explicit mutex(const char *name = nullptr) : name_(name) {}
+        mutex(const mutex &) = delete;
+        mutex &operator=(const mutex &) = delete;
+
+        void lock()
+        {
+            if (!m.try_lock())
+                lockContended();
+            holder.store(detail::current_job, std::memory_order_relaxed);
+        }
+
+        bool try_lock()
+        {
+            if (!m.try_lock())
+                return false;
+            holder.store(detail::current_job, std::memory_order_relaxed);
+            return true;
+        }
+
+        void unlock() { m.unlock(); }
+
+        const char *name() const { return name_; }
+
+    private:
+        void lockContended();
+
+        std::mutex m;
+        std::atomic<uint64_t> holder{0}; // job that last acquired the lock
+        const char *name_;
+    };
+
+    struct LockWaitStats
+    {
+        int64_t wait_ns = 0;
+        uint32_t waits = 0; // lock() calls that had to block
+    };
+
+    // Charges lock waits on this thread to job_id until end(). Scopes nest;
+    // inner waits also count towards the enclosing job.
+    class LockWaitScope
+    {
+    public:
+        void begin(uint64_t job_id);
+        LockWaitStats end();
+
+    private:
+        uint64_t outer_job = 0;
+        LockWaitStats outer;
+    };
+
+    struct LockContention
+    {
+        const void *lock = nullptr;
+        std::string name; // "lock@<address>" for unnamed locks
+        uint64_t waits = 0;
+        int64_t total_wait_ns = 0;
+        int64_t max_wait_ns = 0;
+        uint64_t max_wait_job = 0;    // job that waited longest...
+        uint64_t max_wait_holder = 0; // ...and the job holding the lock then
+    };
+
+    // Locks ordered by total wait, at most top of them (0 = all)
+    std::vector<LockContention> lockContentionReport(size_t top = 10);
+    void writeContentionReport(std::ostream &out, size_t top = 10);
+    void resetLockContention();
+}
@@ -0,0 +1,465 @@
+#include "log_analysis.hpp"
+#include "log_format.hpp"
+#include "log_block.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+    using Histogram = std::unordered_map<int64_t, uint64_t>;
+    using SortedHistogram = std::vector<std::pair<int64_t, uint64_t>>;
+
+    struct Row
+    {
+        int thread_id;
+        int64_t start_ms;
+        int64_t end_ms;
+        int64_t exec_ms;
+        int64_t wait_ms;
+        bool is_anomaly;
+    };
+
+    struct ThreadAccumulator
+    {
+        uint64_t count = 0;
+        double exec_sum = 0.0;
+        double exec_sumsq = 0.0;
+        double wait_sum = 0.0;
+    };
+
+    // Everything one scanning thread learns about its slice of the log
+    struct Partial
+    {
+        uint64_t count = 0;
+        Histogram exec_hist;
+        Histogram wait_hist;
+        Histogram anomaly_exec_hist;
+        Histogram end_hist; // completions per EndTime millisecond
+        std::map<int, ThreadAccumulator> threads;
+        int64_t min_start = std::numeric_limits<int64_t>::max();
+        double efficiency_sum = 0.0;
+        uint64_t efficiency_count = 0;
+
+        // Only jobs whose StartTime falls in [from_ms, to_ms] are counted
+        int64_t from_ms = std::numeric_limits<int64_t>::min();
+        int64_t to_ms = std::numeric_limits<int64_t>::max();
+
+        void add(const Row &row)
+        {
+            if (row.start_ms < from_ms || row.start_ms > to_ms)
+                return;
+            ++count;
+            ++exec_hist[row.exec_ms];
+            ++wait_hist[row.wait_ms];
+            if (row.is_anomaly)
+                ++anomaly_exec_hist[row.exec_ms];
+            ++end_hist[row.end_ms];
+            min_start = std::min(min_start, row.start_ms);
+
+            ThreadAccumulator &t = threads[row.thread_id];
+            ++t.count;
+            t.exec_sum += row.exec_ms;
+            t.exec_sumsq += double(row.exec_ms) * row.exec_ms;
+            t.wait_sum += row.wait_ms;
+
+            int64_t total = row.exec_ms + row.wait_ms;
+            if (total != 0)
+            {
+                efficiency_sum += double(row.exec_ms) / total;
+                ++efficiency_count;
+            }
+        }
+
+        void clear()
+        {
+            int64_t from = from_ms, to = to_ms;
+            *this = Partial();
+            from_ms = from;
+            to_ms = to;
+        }
+
+        void merge(Partial &other)
+        {
+            count += other.count;
+            for (auto &kv : other.exec_hist)
+                exec_hist[kv.first] += kv.second;
+            for (auto &kv : other.wait_hist)
+                wait_hist[kv.first] += kv.second;
+            for (auto &kv : other.anomaly_exec_hist)
+                anomaly_exec_hist[kv.first] += kv.second;
+            for (auto &kv : other.end_hist)
+                end_hist[kv.first] += kv.second;
+            for (auto &kv : other.threads)
+            {
+                ThreadAccumulator &t = threads[kv.first];
+                t.count += kv.second.count;
+                t.exec_sum += kv.second.exec_sum;
+                t.exec_sumsq += kv.second.exec_sumsq;
+                t.wait_sum += kv.second.wait_sum;
+            }
+            min_start = std::min(min_start, other.min_start);
+            efficiency_sum += other.efficiency_sum;
+            efficiency_count += other.efficiency_count;
+            other.clear();
+        }
+    };
+
+    // ---- Binary logs: fixed-width records split evenly between threads ----
+
+    void scanBinary(const unsigned char *records, size_t record_size, size_t first, size_t last, Partial &out)
+    {
+        const int64_t ns_per_ms = 1000000;
+        ExecutionRecord record;
+        for (size_t i = first; i < last; ++i)
+        {
+            binlog::decodeRecord(records + i * record_size, record);
+            Row row;
+            row.thread_id = record.thread_id;
+            int64_t submit_ms = record.submit_ns / ns_per_ms;
+            row.start_ms = record.start_ns / ns_per_ms;
+            row.end_ms = record.end_ns / ns_per_ms;
+            row.exec_ms = row.end_ms - row.start_ms;
+            row.wait_ms = row.start_ms - submit_ms;
+            row.is_anomaly = record.is_anomaly;
+            out.add(row);
+        }
+    }
+
+    // ---- Compressed logs: whole blocks split between threads ----
+
+    void scanBlocks(const unsigned char *data, const std::vector<size_t> &offsets, size_t first, size_t last,
+                    uint32_t time_unit_ns, Partial &out)
+    {
+        const int64_t ns_per_ms = 1000000;
+        std::vector<ExecutionRecord> records;
+        std::vector<unsigned char> scratch;
+        for (size_t b = first; b < last; ++b)
+        {
+            binlog::BlockHeader header;
+            binlog::decodeBlockHeader(data + offsets[b], binlog::kBlockHeaderSize, header);
+            if (!binlog::decodeBlockPayload(header, data + offsets[b] + binlog::kBlockHeaderSize,
+                                            time_unit_ns, records, scratch))
+                continue; // corrupt block: skip it, the rest are independent
+            for (const ExecutionRecord &record : records)
+            {
+                Row row;
+                row.thread_id = record.thread_id;
+                int64_t submit_ms = record.submit_ns / ns_per_ms;
+                row.start_ms = record.start_ns / ns_per_ms;
+                row.end_ms = record.end_ns / ns_per_ms;
+                row.exec_ms = row.end_ms - row.start_ms;
+                row.wait_ms = row.start_ms - submit_ms;
+                row.is_anomaly = record.is_anomaly;
+                out.add(row);
+            }
+        }
+    }
+
+    // ---- CSV logs: byte ranges realigned to line starts ----
+
+    bool parseInt(const char *&p, const char *end, int64_t &value)
+    {
+        bool negative = p < end && *p == '-';
+        if (negative)
+            ++p;
+        if (p >= end || *p < '0' || *p > '9')
+            return false;
+        uint64_t v = 0;
+        while (p < end && *p >= '0' && *p <= '9')
+            v = v * 10 + uint64_t(*p++ - '0');
+        value = negative ? -int64_t(v) : int64_t(v);
+        return true;
+    }
+
+    // JobID,ThreadID,SubmitTime,StartTime,EndTime,ExecDurationMS,QueueWaitMS,IsAnomaly[,...]
+    bool parseCsvLine(const char *p, const char *end, Row &row)
+    {
+        int64_t fields[8];
+        for (int i = 0; i < 8; ++i)
+        {
+            if (!parseInt(p, end, fields[i]))
+                return false;
+            if (i < 7)
+            {
+                if (p >= end || *p != ',')
+                    return false;
+                ++p;
+            }
+        }
+        row.thread_id = (int)fields[1];
+        row.start_ms = fields[3];
+        row.end_ms = fields[4];
+        row.exec_ms = fields[5];
+        row.wait_ms = fields[6];
+        row.is_anomaly = fields[7] != 0;
+        return true;
+    }
+
+    void scanCsv(const char *data, size_t size, size_t begin, size_t end, Partial &out)
+    {
+        // A line belongs to the slice its first byte falls in
+        size_t pos = begin;
+        if (pos > 0 && data[pos - 1] != '\n')
+        {
+            const void *nl = std::memchr(data + pos, '\n', size - pos);
+            pos = nl ? size_t(static_cast<const char *>(nl) - data) + 1 : size;
+        }
+        Row row;
+        while (pos < end)
+        {
+            const void *nl = std::memchr(data + pos, '\n', size - pos);
+            size_t line_end = nl ? size_t(static_cast<const char *>(nl) - data) : size;
+            if (parseCsvLine(data + pos, data + line_end, row)) // skips the header
+                out.add(row);
+            pos = line_end + 1;
+        }
+    }
+
+    // ---- Summary statistics from merged histograms ----
+
+    SortedHistogram sorted(const Histogram &hist)
+    {
+        SortedHistogram out(hist.begin(), hist.end());
+        std::sort(out.begin(), out.end());
+        return out;
+    }
+
+    int64_t valueAtRank(const SortedHistogram &hist, uint64_t rank)
+    {
+        uint64_t seen = 0;
+        for (auto &kv : hist)
+        {
+            seen += kv.second;
+            if (rank < seen)
+                return kv.first;
+        }
+        return hist.empty() ? 0 : hist.back().first;
+    }
+
+    // Linear interpolation between closest ranks, as pandas' quantile()
+    double quantile(const SortedHistogram &hist, uint64_t count, double q)
+    {
+        if (count == 0)
+            return std::nan("");
+        double pos = (count - 1) * q;
+        uint64_t lo = (uint64_t)std::floor(pos);
+        double frac = pos - lo;
+        double a = (double)valueAtRank(hist, lo);
+        if (frac == 0.0)
+            return a;
+        double b = (double)valueAtRank(hist, lo + 1);
+        return a + (b - a) * frac;
+    }
+
+    ValueSummary summarize(const SortedHistogram &hist)
+    {
+        ValueSummary s;
+        double sum = 0.0;
+        for (auto &kv : hist)
+        {
+            s.count += kv.second;
+            sum += double(kv.first) * kv.second;
+        }
+        if (s.count == 0)
+            return s;
+        s.mean = sum / s.count;
+        double sq = 0.0;
+        for (auto &kv : hist)
+            sq += (kv.first - s.mean) * (kv.first - s.mean) * kv.second;
+        s.std_dev = s.count > 1 ? std::sqrt(sq / (s.count - 1)) : std::nan("");
+        s.median = quantile(hist, s.count, 0.5);
+        s.min = hist.front().first;
+        s.max = hist.back().first;
+        return s;
+    }
+
+    uint64_t countOutside(const SortedHistogram &hist, double lower, double upper)
+    {
+        uint64_t n = 0;
+        for (auto &kv : hist)
+            if (kv.first < lower || kv.first > upper)
+                n += kv.second;
+        return n;
+    }
+
+    // NaN bounds (std of a single sample) flag nothing, like pandas
+    uint64_t countBeyondSigma(const SortedHistogram &hist, const ValueSummary &s, double sigmas)
+    {
+        if (!(s.std_dev > 0.0))
+            return 0;
+        return countOutside(hist, s.mean - sigmas * s.std_dev, s.mean + sigmas * s.std_dev);
+    }
+
+    // Scans one file with every thread and folds the result into all
+    bool scanFile(const std::string &filename, unsigned thread_count, Partial &all, std::string &error)
+    {
+        MappedFile file;
+        if (!file.open(filename, error))
+            return false;
+
+        std::vector<Partial> partials(thread_count);
+        for (auto &p : partials)
+        {
+            p.from_ms = all.from_ms;
+            p.to_ms = all.to_ms;
+        }
+        std::vector<std::thread> scanners;
+
+        binlog::Header header;
+        if (binlog::decodeHeader(file.data(), file.size(), header))
+        {
+            if (file.size() < header.header_size)
+            {
+                error = filename + " is truncated";
+                return false;
+            }
+            if (header.compressed())
+            {
+                // Block headers chain by size, so one cheap walk finds them all
+                std::vector<size_t> offsets;
+                size_t pos = header.header_size;
+                binlog::BlockHeader block;
+                while (binlog::decodeBlockHeader(file.data() + pos, file.size() - pos, block) &&
+                       file.size() - pos - binlog::kBlockHeaderSize >= block.stored_size)
+                {
+                    offsets.push_back(pos);
+                    pos += binlog::kBlockHeaderSize + block.stored_size;
+                }
+                for (unsigned t = 0; t < thread_count; ++t)
+                {
+                    size_t first = offsets.size() * t / thread_count;
+                    size_t last = offsets.size() * (t + 1) / thread_count;
+                    scanners.emplace_back(scanBlocks, file.data(), std::cref(offsets), first, last,
+                                          header.time_unit_ns, std::ref(partials[t]));
+                }
+                for (auto &t : scanners)
+                    t.join();
+                for (auto &p : partials)
+                    all.merge(p);
+                return true;
+            }
+            const unsigned char *records = file.data() + header.header_size;
+            size_t record_count = (file.size() - header.header_size) / header.record_size;
+            for (unsigned t = 0; t < thread_count; ++t)
+            {
+                size_t first = record_count * t / thread_count;
+                size_t last = record_count * (t + 1) / thread_count;
+                scanners.emplace_back(scanBinary, records, (size_t)header.record_size, first, last, std::ref(partials[t]));
+            }
+        }
+        else
+        {
+            if (file.size() >= sizeof(binlog::kMagic) &&
+                std::memcmp(file.data(), binlog::kMagic, sizeof(binlog::kMagic)) == 0)
+            {
+                error = filename + " has an unsupported binary log version";
+                return false;
+            }
+            const char *data = reinterpret_cast<const char *>(file.data());
+            for (unsigned t = 0; t < thread_count; ++t)
+            {
+                size_t begin = file.size() * t / thread_count;
+                size_t end = file.size() * (t + 1) / thread_count;
+                scanners.emplace_back(scanCsv, data, file.size(), begin, end, std::ref(partials[t]));
+            }
+        }
+        for (auto &t : scanners)
+            t.join();
+
+        for (auto &p : partials)
+            all.merge(p);
+        return true;
+    }
+}
+
+bool analyzeLog(const std::string &filename, const AnalysisOptions &options,
+                LogSummary &summary, std::string &error)
+{
+    return analyzeLogs(std::vector<std::string>{filename}, options, summary, error);
+}
+
+bool analyzeLogs(const std::vector<std::string> &filenames, const AnalysisOptions &options,
+                 LogSummary &summary, std::string &error)
+{
+    unsigned thread_count = options.threads ? options.threads : std::thread::hardware_concurrency();
+    thread_count = std::max(1u, thread_count);
+
+    Partial all;
+    all.from_ms = options.from_ms;
+    all.to_ms = options.to_ms;
+    for (const std::string &filename : filenames)
+    {
+        if (!scanFile(filename, thread_count, all, error))
+            return false;
+    }
+
+    summary = LogSummary();
+    summary.total_jobs = all.count;
+    summary.window_ms = options.window_ms;
+    if (all.count == 0)
+        return true;
+
+    SortedHistogram exec_hist = sorted(all.exec_hist);
+    SortedHistogram wait_hist = sorted(all.wait_hist);
+    SortedHistogram anomaly_hist = sorted(all.anomaly_exec_hist);
+
+    summary.exec = summarize(exec_hist);
+    summary.wait = summarize(wait_hist);
+
+    ValueSummary anomalies = summarize(anomaly_hist);
+    summary.realtime_anomalies = anomalies.count;
+    summary.realtime_anomaly_mean_ms = anomalies.mean;
+    summary.realtime_anomaly_max_ms = anomalies.max;
+
+    summary.zscore_anomalies = countBeyondSigma(exec_hist, summary.exec, 2.0);
+    summary.realtime_and_zscore = countBeyondSigma(anomaly_hist, summary.exec, 2.0);
+
+    summary.q1 = quantile(exec_hist, summary.exec.count, 0.25);
+    summary.q3 = quantile(exec_hist, summary.exec.count, 0.75);
+    double iqr = summary.q3 - summary.q1;
+    summary.iqr_lower = summary.q1 - 1.5 * iqr;
+    summary.iqr_upper = summary.q3 + 1.5 * iqr;
+    summary.iqr_anomalies = countOutside(exec_hist, summary.iqr_lower, summary.iqr_upper);
+
+    summary.wait_anomalies = countBeyondSigma(wait_hist, summary.wait, 2.0);
+    for (auto &kv : wait_hist)
+        if (kv.first > 1000)
+            summary.waits_over_1s += kv.second;
+
+    summary.mean_efficiency = all.efficiency_count ? all.efficiency_sum / all.efficiency_count : std::nan("");
+
+    for (auto &kv : all.threads)
+    {
+        const ThreadAccumulator &t = kv.second;
+        ThreadSummary ts;
+        ts.thread_id = kv.first;
+        ts.count = t.count;
+        ts.exec_mean = t.exec_sum / t.count;
+        ts.exec_std = t.count > 1
+                          ? std::sqrt(std::max(0.0, (t.exec_sumsq - t.count * ts.exec_mean * ts.exec_mean) / (t.count - 1)))
+                          : std::nan("");
+        ts.wait_mean = t.wait_sum / t.count;
+        summary.threads.push_back(ts);
+    }
+
+    // Windows [k*w, (k+1)*w) over EndTime relative to the first StartTime;
+    // like np.arange(0, max, w) the trailing partial window is dropped
+    int64_t max_rel = 0;
+    for (auto &kv : all.end_hist)
+        max_rel = std::max(max_rel, kv.first - all.min_start);
+    int64_t edges = max_rel > 0 ? (max_rel + options.window_ms - 1) / options.window_ms : 0;
+    summary.throughput.assign(edges > 1 ? (size_t)(edges - 1) : 0, 0);
+    for (auto &kv : all.end_hist)
+    {
+        int64_t window = (kv.first - all.min_start) / options.window_ms;
+        if (window >= 0 && window < (int64_t)summary.throughput.size())
+            summary.throughput[(size_t)window] += kv.second;
+    }
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+// ------------------- Offline Log Analysis ---------------------
+// Computes the summary ai/visualize_logs.py produces (z-score, IQR and
+// queue-wait anomalies, per-thread stats, windowed throughput) in one pass
+// over a memory-mapped CSV or binary log, split across worker threads.
+// Statistics are exact: durations are whole milliseconds, so each thread
+// keeps value histograms and quantiles/z-scores are resolved after merging.
+
+struct ValueSummary
+{
+    uint64_t count = 0;
+    double mean = 0.0;
+    double std_dev = 0.0; // sample standard deviation, as pandas' std()
+    double median = 0.0;
+    int64_t min = 0;
+    int64_t max = 0;
+};
+
+struct ThreadSummary
+{
+    int thread_id = 0;
+    uint64_t count = 0;
+    double exec_mean = 0.0;
+    double exec_std = 0.0;
+    double wait_mean = 0.0;
+};
+
+struct LogSummary
+{
+    uint64_t total_jobs = 0;
+
+    ValueSummary exec;
+    ValueSummary wait;
+
+    uint64_t realtime_anomalies = 0; // IsAnomaly flags written by Logger
+    double realtime_anomaly_mean_ms = 0.0;
+    int64_t realtime_anomaly_max_ms = 0;
+
+    uint64_t zscore_anomalies = 0;   // |exec - mean| > 2 std
+    uint64_t realtime_and_zscore = 0;
+    double q1 = 0.0, q3 = 0.0;
+    double iqr_lower = 0.0, iqr_upper = 0.0;
+    uint64_t iqr_anomalies = 0;
+    uint64_t wait_anomalies = 0;     // |wait - mean| > 2 std
+    uint64_t waits_over_1s = 0;
+
+    double mean_efficiency = 0.0;    // mean of exec / (exec + wait)
+
+    std::vector<ThreadSummary> threads;
+
+    int64_t window_ms = 500;
+    std::vector<uint64_t> throughput; // jobs completed per window
+};
+
+struct AnalysisOptions
+{
+    unsigned threads = 0; // 0 = hardware concurrency
+    int64_t window_ms = 500;
+
+    // Only jobs whose StartTime (ms, as in the CSV) falls in this range
+    int64_t from_ms = std::numeric_limits<int64_t>::min();
+    int64_t to_ms = std::numeric_limits<int64_t>::max();
+};
+
+// Returns false (with a message in error) if the log can't be read
+bool analyzeLog(const std::string &filename, const AnalysisOptions &options,
+                LogSummary &summary, std::string &error);
+
+// Summary over several files, e.g. the segments of a rotated log
+bool analyzeLogs(const std::vector<std::string> &filenames, const AnalysisOptions &options,
+                 LogSummary &summary, std::string &error);
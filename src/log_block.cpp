@@ -0,0 +1,269 @@
+#include "log_block.hpp"
+#include "lz.hpp"
+#include <algorithm>
+#include <limits>
+#include <unordered_map>
+
+namespace
+{
+    constexpr int kBaseColumns = 8;
+
+    int columnCount(uint32_t groups)
+    {
+        int columns = kBaseColumns;
+        if (groups & kGroupPerf)
+            columns += 1 + kPerfCounterCount;
+        if (groups & kGroupCpu)
+            columns += 4;
+        if (groups & kGroupAlloc)
+            columns += 3;
+        if (groups & kGroupLock)
+            columns += 2;
+        return columns;
+    }
+
+    inline uint64_t zigzag(int64_t v)
+    {
+        return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+    }
+
+    inline int64_t unzigzag(uint64_t v)
+    {
+        return int64_t(v >> 1) ^ -int64_t(v & 1);
+    }
+
+    void putVarint(std::vector<unsigned char> &out, uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            out.push_back((unsigned char)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((unsigned char)v);
+    }
+
+    bool getVarint(const unsigned char *&p, const unsigned char *end, uint64_t &v)
+    {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (p >= end)
+                return false;
+            unsigned char b = *p++;
+            v |= uint64_t(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    // Floor division, so negative timestamps quantize consistently
+    inline int64_t toUnits(int64_t ns, int64_t unit)
+    {
+        int64_t q = ns / unit;
+        return (ns % unit != 0 && ns < 0) ? q - 1 : q;
+    }
+
+    uint32_t fnv1a(const unsigned char *data, size_t size)
+    {
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < size; ++i)
+            h = (h ^ data[i]) * 16777619u;
+        return h;
+    }
+
+    struct ThreadCursor
+    {
+        int64_t last_start = 0;
+        uint64_t last_job_id = 0;
+    };
+}
+
+namespace binlog
+{
+    void encodeBlock(const std::vector<ExecutionRecord> &records, uint32_t time_unit_ns,
+                     std::vector<unsigned char> &out)
+    {
+        const int64_t unit = time_unit_ns;
+        uint32_t groups = 0;
+        for (const ExecutionRecord &r : records)
+            groups |= r.groups;
+        groups &= kBlockGroupMask >> kBlockGroupShift;
+        std::vector<std::vector<unsigned char>> columns(columnCount(groups));
+        std::unordered_map<int32_t, ThreadCursor> cursors;
+        int64_t min_start = std::numeric_limits<int64_t>::max();
+        int64_t max_end = std::numeric_limits<int64_t>::min();
+
+        for (const ExecutionRecord &r : records)
+        {
+            int64_t submit = toUnits(r.submit_ns, unit);
+            int64_t start = toUnits(r.start_ns, unit);
+            int64_t end = toUnits(r.end_ns, unit);
+            ThreadCursor &cursor = cursors[r.thread_id];
+
+            putVarint(columns[0], zigzag(r.thread_id));
+            putVarint(columns[1], zigzag(start - cursor.last_start));
+            putVarint(columns[2], zigzag(start - submit));
+            putVarint(columns[3], zigzag(end - start));
+            putVarint(columns[4], zigzag(int64_t(r.job_id - cursor.last_job_id)));
+            putVarint(columns[5], zigzag(r.priority));
+            putVarint(columns[6], zigzag(r.preferred_thread));
+            putVarint(columns[7], recordFlags(r));
+            int c = kBaseColumns;
+            if (groups & kGroupPerf)
+            {
+                bool measured = (r.groups & kGroupPerf) != 0;
+                putVarint(columns[c++], measured ? r.perf_valid : 0u);
+                for (int i = 0; i < kPerfCounterCount; ++i)
+                    putVarint(columns[c++], measured ? r.perf[i] : 0u);
+            }
+            if (groups & kGroupCpu)
+            {
+                bool measured = (r.groups & kGroupCpu) != 0;
+                putVarint(columns[c++], measured ? zigzag(r.cpu_ns) : 0u);
+                putVarint(columns[c++], measured ? r.voluntary_switches : 0u);
+                putVarint(columns[c++], measured ? r.involuntary_switches : 0u);
+                putVarint(columns[c++], measured ? r.on_cpu_permille : 0u);
+            }
+            if (groups & kGroupAlloc)
+            {
+                bool measured = (r.groups & kGroupAlloc) != 0;
+                putVarint(columns[c++], measured ? r.alloc_bytes : 0u);
+                putVarint(columns[c++], measured ? r.allocations : 0u);
+                putVarint(columns[c++], measured ? r.alloc_peak_bytes : 0u);
+            }
+            if (groups & kGroupLock)
+            {
+                bool measured = (r.groups & kGroupLock) != 0;
+                putVarint(columns[c++], measured ? zigzag(r.lock_wait_ns) : 0u);
+                putVarint(columns[c++], measured ? r.lock_waits : 0u);
+            }
+
+            cursor.last_start = start;
+            cursor.last_job_id = r.job_id;
+            min_start = std::min(min_start, r.start_ns);
+            max_end = std::max(max_end, r.end_ns);
+        }
+
+        std::vector<unsigned char> raw;
+        for (auto &column : columns)
+            raw.insert(raw.end(), column.begin(), column.end());
+
+        std::vector<unsigned char> packed;
+        lz::compress(raw.data(), raw.size(), packed);
+        bool compressed = packed.size() < raw.size();
+        const std::vector<unsigned char> &payload = compressed ? packed : raw;
+
+        size_t offset = out.size();
+        out.resize(offset + kBlockHeaderSize);
+        unsigned char *h = out.data() + offset;
+        putU32(h + 0, kBlockMagic);
+        putU32(h + 4, (uint32_t)payload.size());
+        putU32(h + 8, (uint32_t)raw.size());
+        putU32(h + 12, (uint32_t)records.size());
+        putU32(h + 16, (compressed ? kBlockCompressed : 0u) | (groups << kBlockGroupShift));
+        putU32(h + 20, fnv1a(payload.data(), payload.size()));
+        putU64(h + 24, (uint64_t)min_start);
+        putU64(h + 32, (uint64_t)max_end);
+        out.insert(out.end(), payload.begin(), payload.end());
+    }
+
+    bool decodeBlockHeader(const unsigned char *in, size_t size, BlockHeader &header)
+    {
+        if (size < kBlockHeaderSize || getU32(in) != kBlockMagic)
+            return false;
+        header.stored_size = getU32(in + 4);
+        header.raw_size = getU32(in + 8);
+        header.record_count = getU32(in + 12);
+        header.flags = getU32(in + 16);
+        header.checksum = getU32(in + 20);
+        header.min_start_ns = (int64_t)getU64(in + 24);
+        header.max_end_ns = (int64_t)getU64(in + 32);
+        return true;
+    }
+
+    bool decodeBlockPayload(const BlockHeader &header, const unsigned char *payload, uint32_t time_unit_ns,
+                            std::vector<ExecutionRecord> &records, std::vector<unsigned char> &scratch)
+    {
+        if (fnv1a(payload, header.stored_size) != header.checksum)
+            return false;
+
+        const unsigned char *raw = payload;
+        size_t raw_size = header.stored_size;
+        if (header.flags & kBlockCompressed)
+        {
+            if (!lz::decompress(payload, header.stored_size, header.raw_size, scratch))
+                return false;
+            raw = scratch.data();
+            raw_size = scratch.size();
+        }
+
+        const int64_t unit = time_unit_ns;
+        const size_t n = header.record_count;
+        const uint32_t groups = (header.flags & kBlockGroupMask) >> kBlockGroupShift;
+        const int column_count = columnCount(groups);
+        if (n * column_count > raw_size) // every value takes at least one byte
+            return false;
+        std::vector<uint64_t> values(n * column_count);
+        const unsigned char *p = raw;
+        const unsigned char *end = raw + raw_size;
+        for (int c = 0; c < column_count; ++c)
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (!getVarint(p, end, values[c * n + i]))
+                    return false;
+            }
+        }
+
+        records.resize(n);
+        std::unordered_map<int32_t, ThreadCursor> cursors;
+        for (size_t i = 0; i < n; ++i)
+        {
+            ExecutionRecord &r = records[i];
+            r.thread_id = (int32_t)unzigzag(values[0 * n + i]);
+            ThreadCursor &cursor = cursors[r.thread_id];
+            int64_t start = cursor.last_start + unzigzag(values[1 * n + i]);
+            int64_t submit = start - unzigzag(values[2 * n + i]);
+            int64_t finish = start + unzigzag(values[3 * n + i]);
+            r.job_id = cursor.last_job_id + (uint64_t)unzigzag(values[4 * n + i]);
+            r.priority = (int32_t)unzigzag(values[5 * n + i]);
+            r.preferred_thread = (int32_t)unzigzag(values[6 * n + i]);
+            applyRecordFlags((uint32_t)values[7 * n + i], r);
+            r.groups &= groups;
+            int c = kBaseColumns;
+            r.perf_valid = 0;
+            if (groups & kGroupPerf)
+            {
+                r.perf_valid = (uint32_t)values[c++ * n + i];
+                for (int k = 0; k < kPerfCounterCount; ++k)
+                    r.perf[k] = values[c++ * n + i];
+            }
+            if (groups & kGroupCpu)
+            {
+                r.cpu_ns = unzigzag(values[c++ * n + i]);
+                r.voluntary_switches = (uint32_t)values[c++ * n + i];
+                r.involuntary_switches = (uint32_t)values[c++ * n + i];
+                r.on_cpu_permille = (uint32_t)values[c++ * n + i];
+            }
+            if (groups & kGroupAlloc)
+            {
+                r.alloc_bytes = values[c++ * n + i];
+                r.allocations = values[c++ * n + i];
+                r.alloc_peak_bytes = values[c++ * n + i];
+            }
+            if (groups & kGroupLock)
+            {
+                r.lock_wait_ns = unzigzag(values[c++ * n + i]);
+                r.lock_waits = (uint32_t)values[c++ * n + i];
+            }
+            r.submit_ns = submit * unit;
+            r.start_ns = start * unit;
+            r.end_ns = finish * unit;
+
+            cursor.last_start = start;
+            cursor.last_job_id = r.job_id;
+        }
+        return true;
+    }
+}
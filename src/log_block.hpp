@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "log_format.hpp"
+
+// ------------------- Compressed Log Blocks ---------------------
+// A version-2 log is the file header followed by blocks of up to
+// block_records records. Each block decodes on its own, so readers can
+// seek to any block (e.g. by time) without touching the ones before it.
+//
+// Block header (40 bytes, little-endian):
+//   0  u32 magic "ABLK"
+//   4  u32 stored_size    payload bytes that follow the header
+//   8  u32 raw_size       payload size before LZ compression
+//  12  u32 record_count
+//  16  u32 flags          bit 0 = payload is LZ-compressed,
+//                         bits 8-15 = optional record groups present
+//  20  u32 checksum       FNV-1a of the stored payload
+//  24  i64 min_start_ns
+//  32  i64 max_end_ns
+//
+// The raw payload is columnar, one zigzag varint per record per column:
+// thread_id, start delta (vs. the previous start on the same thread),
+// queue wait, exec duration, job_id delta (same thread), priority,
+// preferred_thread, flags, then one column per field of each optional
+// group in the block (log_format.hpp). Times are in units of the header's
+// time_unit_ns and per-thread deltas restart at every block.
+namespace binlog
+{
+    constexpr size_t kBlockHeaderSize = 40;
+    constexpr uint32_t kBlockMagic = 0x4B4C4241; // "ABLK"
+    constexpr uint32_t kBlockCompressed = 1u << 0;
+    constexpr int kBlockGroupShift = 8;
+    constexpr uint32_t kBlockGroupMask = 0xffu << kBlockGroupShift;
+    constexpr uint32_t kDefaultBlockRecords = 4096;
+    constexpr uint32_t kDefaultTimeUnitNs = 1000; // microseconds; CSV only keeps milliseconds
+
+    struct BlockHeader
+    {
+        uint32_t stored_size = 0;
+        uint32_t raw_size = 0;
+        uint32_t record_count = 0;
+        uint32_t flags = 0;
+        uint32_t checksum = 0;
+        int64_t min_start_ns = 0;
+        int64_t max_end_ns = 0;
+    };
+
+    // Appends header + payload for records to out
+    void encodeBlock(const std::vector<ExecutionRecord> &records, uint32_t time_unit_ns,
+                     std::vector<unsigned char> &out);
+
+    bool decodeBlockHeader(const unsigned char *in, size_t size, BlockHeader &header);
+
+    // Decodes a block's stored payload; scratch is reused between calls
+    bool decodeBlockPayload(const BlockHeader &header, const unsigned char *payload, uint32_t time_unit_ns,
+                            std::vector<ExecutionRecord> &records, std::vector<unsigned char> &scratch);
+}
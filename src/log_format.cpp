@@ -0,0 +1,302 @@
+#include "log_format.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+LogFormat resolveLogFormat(LogFormat format, const std::string &filename)
+{
+    if (format != LogFormat::Auto)
+        return format;
+    auto ends_with = [&filename](const std::string &ext)
+    {
+        return filename.size() >= ext.size() &&
+               filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0;
+    };
+    if (ends_with(".bin"))
+        return LogFormat::Binary;
+    if (ends_with(".binz"))
+        return LogFormat::CompressedBinary;
+    return LogFormat::Csv;
+}
+
+const char *anomalyKindName(AnomalyKind kind)
+{
+    switch (kind)
+    {
+    case AnomalyKind::Compute:
+        return "compute";
+    case AnomalyKind::Memory:
+        return "memory";
+    case AnomalyKind::Blocked:
+        return "blocked";
+    case AnomalyKind::Contention:
+        return "contention";
+    default:
+        return "";
+    }
+}
+
+std::string csvHeader(uint32_t groups)
+{
+    std::string header = "JobID,ThreadID,SubmitTime,StartTime,EndTime,ExecDurationMS,QueueWaitMS,IsAnomaly,AffinityHit,JobClass";
+    if (groups & kGroupPerf)
+        header += ",Cycles,Instructions,LLCMisses,ContextSwitches,PageFaults,TaskClockNS";
+    if (groups & kGroupCpu)
+        header += ",CpuTimeUS,OnCpuRatio,VoluntaryCS,InvoluntaryCS";
+    if (groups & kGroupAlloc)
+        header += ",AllocBytes,Allocations,PeakAllocBytes";
+    if (groups & kGroupLock)
+        header += ",LockWaitUS,LockWaits";
+    if (groups)
+        header += ",AnomalyKind";
+    return header;
+}
+
+void writeCsvHeader(std::ostream &out, uint32_t groups)
+{
+    out << csvHeader(groups) << "\n";
+}
+
+void writeCsvRow(std::ostream &out, const ExecutionRecord &record, uint32_t groups)
+{
+    // Millisecond truncation matches duration_cast<milliseconds>
+    const int64_t ns_per_ms = 1000000;
+    int64_t submit_ms = record.submit_ns / ns_per_ms;
+    int64_t start_ms = record.start_ns / ns_per_ms;
+    int64_t end_ms = record.end_ns / ns_per_ms;
+
+    const char *affinity_hit = record.preferred_thread < 0
+                                   ? "-1"
+                                   : (record.preferred_thread == record.thread_id ? "1" : "0");
+
+    out << record.job_id << "," << record.thread_id << ","
+        << submit_ms << "," << start_ms << "," << end_ms << ","
+        << (end_ms - start_ms) << "," << (start_ms - submit_ms) << ","
+        << (record.is_anomaly ? "1" : "0") << ","
+        << affinity_hit << "," << int(record.job_class);
+
+    // Unmeasured values are left empty so pandas reads them as NaN
+    if (groups & kGroupPerf)
+    {
+        bool measured = (record.groups & kGroupPerf) != 0;
+        for (int i = 0; i < kPerfCounterCount; ++i)
+        {
+            out << ",";
+            if (measured && (record.perf_valid & (1u << i)))
+                out << record.perf[i];
+        }
+    }
+    if (groups & kGroupCpu)
+    {
+        if (record.groups & kGroupCpu)
+        {
+            char ratio[16];
+            std::snprintf(ratio, sizeof(ratio), "%u.%03u", record.on_cpu_permille / 1000,
+                          record.on_cpu_permille % 1000);
+            out << "," << record.cpu_ns / 1000 << "," << ratio << ","
+                << record.voluntary_switches << "," << record.involuntary_switches;
+        }
+        else
+        {
+            out << ",,,,";
+        }
+    }
+    if (groups & kGroupAlloc)
+    {
+        if (record.groups & kGroupAlloc)
+            out << "," << record.alloc_bytes << "," << record.allocations << "," << record.alloc_peak_bytes;
+        else
+            out << ",,,";
+    }
+    if (groups & kGroupLock)
+    {
+        if (record.groups & kGroupLock)
+            out << "," << record.lock_wait_ns / 1000 << "," << record.lock_waits;
+        else
+            out << ",,";
+    }
+    if (groups)
+        out << "," << anomalyKindName(record.anomaly_kind);
+    out << "\n";
+}
+
+bool parseCsvRow(const std::string &line, ExecutionRecord &record)
+{
+    const int64_t ns_per_ms = 1000000;
+    int64_t fields[10];
+    const char *p = line.c_str();
+    for (int i = 0; i < 10; ++i)
+    {
+        char *end;
+        fields[i] = std::strtoll(p, &end, 10);
+        if (end == p || (i < 9 && *end != ','))
+            return false; // the header, or a truncated row
+        p = end + 1;
+    }
+    record = ExecutionRecord();
+    record.job_id = uint64_t(fields[0]);
+    record.thread_id = int32_t(fields[1]);
+    record.submit_ns = fields[2] * ns_per_ms;
+    record.start_ns = fields[3] * ns_per_ms;
+    record.end_ns = fields[4] * ns_per_ms;
+    record.is_anomaly = fields[7] != 0;
+    record.job_class = uint8_t(fields[9]);
+    return true;
+}
+
+namespace binlog
+{
+    size_t groupRecordSize(uint32_t groups)
+    {
+        return ((groups & kGroupPerf) ? kPerfGroupSize : 0) +
+               ((groups & kGroupCpu) ? kCpuGroupSize : 0) +
+               ((groups & kGroupAlloc) ? kAllocGroupSize : 0) +
+               ((groups & kGroupLock) ? kLockGroupSize : 0);
+    }
+
+    Header makeHeader(int thread_count)
+    {
+        using namespace std::chrono;
+        Header header;
+        header.thread_count = (uint16_t)thread_count;
+        header.hr_anchor_ns = duration_cast<nanoseconds>(high_resolution_clock::now().time_since_epoch()).count();
+        header.system_anchor_ns = duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count();
+        header.steady_anchor_ns = duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+        return header;
+    }
+
+    void encodeHeader(const Header &header, unsigned char *out)
+    {
+        std::memset(out, 0, kHeaderSize);
+        std::memcpy(out, kMagic, sizeof(kMagic));
+        putU16(out + 8, header.version);
+        putU16(out + 10, header.header_size);
+        putU16(out + 12, header.record_size);
+        putU16(out + 14, header.thread_count);
+        putU64(out + 16, (uint64_t)header.hr_anchor_ns);
+        putU64(out + 24, (uint64_t)header.system_anchor_ns);
+        putU64(out + 32, (uint64_t)header.steady_anchor_ns);
+        if (header.compressed())
+        {
+            putU32(out + 40, header.time_unit_ns);
+            putU32(out + 44, header.block_records);
+        }
+        putU32(out + 48, header.record_groups);
+    }
+
+    bool decodeHeader(const unsigned char *in, size_t size, Header &header)
+    {
+        if (size < kHeaderSize || std::memcmp(in, kMagic, sizeof(kMagic)) != 0)
+            return false;
+        header.version = getU16(in + 8);
+        header.header_size = getU16(in + 10);
+        header.record_size = getU16(in + 12);
+        header.thread_count = getU16(in + 14);
+        header.hr_anchor_ns = (int64_t)getU64(in + 16);
+        header.system_anchor_ns = (int64_t)getU64(in + 24);
+        header.steady_anchor_ns = (int64_t)getU64(in + 32);
+        header.record_groups = getU32(in + 48);
+        if (header.header_size < kHeaderSize)
+            return false;
+        if (header.version == kCompressedVersion)
+        {
+            header.time_unit_ns = getU32(in + 40);
+            header.block_records = getU32(in + 44);
+            return header.time_unit_ns > 0;
+        }
+        header.time_unit_ns = 1;
+        header.block_records = 0;
+        return header.version == kVersion &&
+               header.record_size >= kRecordSize + groupRecordSize(header.record_groups);
+    }
+
+    void encodeRecord(const ExecutionRecord &record, unsigned char *out, uint32_t groups)
+    {
+        putU64(out + 0, record.job_id);
+        putU64(out + 8, (uint64_t)record.submit_ns);
+        putU64(out + 16, (uint64_t)record.start_ns);
+        putU64(out + 24, (uint64_t)record.end_ns);
+        putU32(out + 32, (uint32_t)record.thread_id);
+        putU32(out + 36, (uint32_t)record.priority);
+        putU32(out + 40, (uint32_t)record.preferred_thread);
+        putU32(out + 44, recordFlags(record));
+
+        unsigned char *group = out + kRecordSize;
+        if (groups & kGroupPerf)
+        {
+            bool measured = (record.groups & kGroupPerf) != 0;
+            putU32(group, measured ? record.perf_valid : 0u);
+            for (int i = 0; i < kPerfCounterCount; ++i)
+                putU64(group + 4 + 8 * i, measured ? record.perf[i] : 0);
+            group += kPerfGroupSize;
+        }
+        if (groups & kGroupCpu)
+        {
+            bool measured = (record.groups & kGroupCpu) != 0;
+            putU64(group, measured ? (uint64_t)record.cpu_ns : 0);
+            putU32(group + 8, measured ? record.voluntary_switches : 0u);
+            putU32(group + 12, measured ? record.involuntary_switches : 0u);
+            putU32(group + 16, measured ? record.on_cpu_permille : 0u);
+            group += kCpuGroupSize;
+        }
+        if (groups & kGroupAlloc)
+        {
+            bool measured = (record.groups & kGroupAlloc) != 0;
+            putU64(group, measured ? record.alloc_bytes : 0);
+            putU64(group + 8, measured ? record.allocations : 0);
+            putU64(group + 16, measured ? record.alloc_peak_bytes : 0);
+            group += kAllocGroupSize;
+        }
+        if (groups & kGroupLock)
+        {
+            bool measured = (record.groups & kGroupLock) != 0;
+            putU64(group, measured ? (uint64_t)record.lock_wait_ns : 0);
+            putU32(group + 8, measured ? record.lock_waits : 0u);
+            group += kLockGroupSize;
+        }
+    }
+
+    void decodeRecord(const unsigned char *in, ExecutionRecord &record, uint32_t groups)
+    {
+        record.job_id = getU64(in + 0);
+        record.submit_ns = (int64_t)getU64(in + 8);
+        record.start_ns = (int64_t)getU64(in + 16);
+        record.end_ns = (int64_t)getU64(in + 24);
+        record.thread_id = (int32_t)getU32(in + 32);
+        record.priority = (int32_t)getU32(in + 36);
+        record.preferred_thread = (int32_t)getU32(in + 40);
+        applyRecordFlags(getU32(in + 44), record);
+        record.groups &= groups;
+
+        const unsigned char *group = in + kRecordSize;
+        if (groups & kGroupPerf)
+        {
+            record.perf_valid = getU32(group);
+            for (int i = 0; i < kPerfCounterCount; ++i)
+                record.perf[i] = getU64(group + 4 + 8 * i);
+            group += kPerfGroupSize;
+        }
+        if (groups & kGroupCpu)
+        {
+            record.cpu_ns = (int64_t)getU64(group);
+            record.voluntary_switches = getU32(group + 8);
+            record.involuntary_switches = getU32(group + 12);
+            record.on_cpu_permille = getU32(group + 16);
+            group += kCpuGroupSize;
+        }
+        if (groups & kGroupAlloc)
+        {
+            record.alloc_bytes = getU64(group);
+            record.allocations = getU64(group + 8);
+            record.alloc_peak_bytes = getU64(group + 16);
+            group += kAllocGroupSize;
+        }
+        if (groups & kGroupLock)
+        {
+            record.lock_wait_ns = (int64_t)getU64(group);
+            record.lock_waits = getU32(group + 8);
+            group += kLockGroupSize;
+        }
+    }
+}
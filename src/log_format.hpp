@@ -0,0 +1,251 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// ------------------- Optional Record Groups ---------------------
+// Extra per-job measurements that are only logged when enabled, so logs
+// without them keep their original size. A log's header lists the groups
+// its records have room for; each record says which it actually measured.
+constexpr uint32_t kGroupPerf = 1u << 0; // perf_event_open counters
+constexpr uint32_t kGroupCpu = 1u << 1;  // thread CPU time and context switches
+constexpr uint32_t kGroupAlloc = 1u << 2; // heap allocations (alloc_tracker.hpp)
+constexpr uint32_t kGroupLock = 1u << 3;  // anomsched::mutex waits (lock_profiler.hpp)
+
+// What the detector thinks made an anomalous job slow
+enum class AnomalyKind : uint8_t
+{
+    None,    // not an anomaly, or no resource data to tell
+    Compute, // on CPU the whole time
+    Memory,  // page faults / cache misses dominate
+    Blocked,   // mostly off CPU: sleeping, waiting on I/O or locks
+    Contention // mostly waiting on an anomsched::mutex
+};
+constexpr int kAnomalyKindCount = 5;
+
+const char *anomalyKindName(AnomalyKind kind);
+
+enum PerfCounter
+{
+    kPerfCycles,
+    kPerfInstructions,
+    kPerfLlcMisses,
+    kPerfContextSwitches,
+    kPerfPageFaults,
+    kPerfTaskClock, // ns on CPU; software, so it works where hardware counters don't
+    kPerfCounterCount
+};
+
+// ------------------- Execution Record ---------------------
+// One executed job as seen by Logger. Times are high_resolution_clock
+// nanoseconds since its epoch, the same clock Job::submit_time uses.
+struct ExecutionRecord
+{
+    uint64_t job_id = 0;
+    int32_t thread_id = 0;
+    int32_t priority = 0;
+    int32_t preferred_thread = -1; // -1 = no affinity
+    uint8_t job_class = 0;         // JobOptions::job_class
+    int64_t submit_ns = 0;
+    int64_t start_ns = 0;
+    int64_t end_ns = 0;
+    bool is_anomaly = false;
+    AnomalyKind anomaly_kind = AnomalyKind::None;
+
+    uint32_t groups = 0; // kGroup* bits measured for this job
+
+    // kGroupPerf: counter deltas over the task; bit i of perf_valid is set
+    // if PerfCounter i could be read on this worker
+    uint32_t perf_valid = 0;
+    uint64_t perf[kPerfCounterCount] = {};
+
+    // kGroupCpu: CLOCK_THREAD_CPUTIME_ID and RUSAGE_THREAD deltas over the
+    // task, plus CPU time as a share of its wall time
+    int64_t cpu_ns = 0;
+    uint32_t voluntary_switches = 0;   // blocked: sleep, I/O, lock waits
+    uint32_t involuntary_switches = 0; // preempted
+    uint32_t on_cpu_permille = 0;
+
+    // kGroupAlloc: heap use of the task
+    uint64_t alloc_bytes = 0;
+    uint64_t allocations = 0;
+    uint64_t alloc_peak_bytes = 0;
+
+    // kGroupLock: time the task spent blocked in anomsched::mutex::lock()
+    int64_t lock_wait_ns = 0;
+    uint32_t lock_waits = 0;
+};
+
+enum class LogFormat
+{
+    Auto,            // ".bin" -> Binary, ".binz" -> CompressedBinary, otherwise CSV
+    Csv,
+    Binary,
+    CompressedBinary // delta/varint-coded, LZ-compressed blocks
+};
+
+LogFormat resolveLogFormat(LogFormat format, const std::string &filename);
+
+// ------------------- CSV Schema ---------------------
+// Shared by Logger and anomsched-logcat so both emit identical CSV. Each
+// enabled group appends its columns, followed by AnomalyKind.
+std::string csvHeader(uint32_t groups = 0);
+void writeCsvHeader(std::ostream &out, uint32_t groups = 0);
+void writeCsvRow(std::ostream &out, const ExecutionRecord &record, uint32_t groups = 0);
+// Reads back the leading columns (through JobClass) of a row; times come
+// back as whole milliseconds and there is no priority. False for the header.
+bool parseCsvRow(const std::string &line, ExecutionRecord &record);
+
+// ------------------- Binary Schema ---------------------
+// File = BinaryLogHeader followed by fixed-width records, all little-endian.
+//
+// Header (64 bytes):
+//   0  char[8] magic "ANOMLOG\0"
+//   8  u16     version
+//  10  u16     header_size
+//  12  u16     record_size
+//  14  u16     thread_count
+//  16  i64     hr_anchor_ns      high_resolution_clock reading at open
+//  24  i64     system_anchor_ns  system_clock reading at the same instant
+//  32  i64     steady_anchor_ns  steady_clock reading at the same instant
+//  40  u32     time_unit_ns      version 2 only: timestamp resolution
+//  44  u32     block_records     version 2 only: max records per block
+//  48  u32     record_groups     optional groups the records carry
+//  52  reserved (zero)
+//
+// Version 1 is followed by fixed-width records:
+//
+// Record (48 bytes):
+//   0  u64 job_id
+//   8  i64 submit_ns
+//  16  i64 start_ns
+//  24  i64 end_ns
+//  32  i32 thread_id
+//  36  i32 priority
+//  40  i32 preferred_thread
+//  44  u32 flags (bit 0 = anomaly, bits 8-15 = job class,
+//                 bits 16-23 = groups measured, bits 24-27 = anomaly kind)
+//
+// followed by one block per group in record_groups, in bit order, so
+// record_size = 48 + the sizes of those blocks:
+//
+// kGroupPerf (52 bytes):
+//   0  u32 perf_valid
+//   4  u64 cycles, instructions, llc_misses, context_switches, page_faults,
+//         task_clock_ns
+//
+// kGroupCpu (20 bytes):
+//   0  i64 cpu_ns
+//   8  u32 voluntary_switches
+//  12  u32 involuntary_switches
+//  16  u32 on_cpu_permille
+//
+// kGroupAlloc (24 bytes):
+//   0  u64 alloc_bytes
+//   8  u64 allocations
+//  16  u64 alloc_peak_bytes
+//
+// kGroupLock (12 bytes):
+//   0  i64 lock_wait_ns
+//   8  u32 lock_waits
+//
+// Version 2 (compressed) is followed by independently decodable blocks;
+// see log_block.hpp.
+namespace binlog
+{
+    constexpr char kMagic[8] = {'A', 'N', 'O', 'M', 'L', 'O', 'G', '\0'};
+    constexpr uint16_t kVersion = 1;
+    constexpr uint16_t kCompressedVersion = 2;
+    constexpr size_t kHeaderSize = 64;
+    constexpr size_t kRecordSize = 48;
+
+    constexpr uint32_t kFlagAnomaly = 1u << 0;
+    constexpr int kJobClassShift = 8;     // job class lives in flags bits 8-15
+    constexpr int kGroupsShift = 16;      // groups measured, bits 16-23
+    constexpr int kAnomalyKindShift = 24; // anomaly kind, bits 24-27
+    constexpr size_t kPerfGroupSize = 4 + 8 * kPerfCounterCount;
+    constexpr size_t kCpuGroupSize = 20;
+    constexpr size_t kAllocGroupSize = 24;
+    constexpr size_t kLockGroupSize = 12;
+
+    inline uint32_t recordFlags(const ExecutionRecord &record)
+    {
+        return (record.is_anomaly ? kFlagAnomaly : 0u) | (uint32_t(record.job_class) << kJobClassShift) |
+               ((record.groups & 0xffu) << kGroupsShift) |
+               ((uint32_t(record.anomaly_kind) & 0xfu) << kAnomalyKindShift);
+    }
+    inline void applyRecordFlags(uint32_t flags, ExecutionRecord &record)
+    {
+        record.is_anomaly = (flags & kFlagAnomaly) != 0;
+        record.job_class = (uint8_t)(flags >> kJobClassShift);
+        record.groups = (flags >> kGroupsShift) & 0xffu;
+        record.anomaly_kind = (AnomalyKind)((flags >> kAnomalyKindShift) & 0xfu);
+    }
+
+    // Bytes the optional groups add to a version 1 record
+    size_t groupRecordSize(uint32_t groups);
+
+    struct Header
+    {
+        uint16_t version = kVersion;
+        uint16_t header_size = kHeaderSize;
+        uint16_t record_size = kRecordSize;
+        uint16_t thread_count = 0;
+        int64_t hr_anchor_ns = 0;
+        int64_t system_anchor_ns = 0;
+        int64_t steady_anchor_ns = 0;
+        uint32_t time_unit_ns = 1;
+        uint32_t block_records = 0;
+        uint32_t record_groups = 0;
+
+        bool compressed() const { return version == kCompressedVersion; }
+    };
+
+    // Header stamped with the current time on all three clocks
+    Header makeHeader(int thread_count);
+
+    void encodeHeader(const Header &header, unsigned char *out);
+    // Returns false if the bytes are not a header this build can read
+    bool decodeHeader(const unsigned char *in, size_t size, Header &header);
+
+    // groups = the file's record_groups; only those blocks are read/written
+    void encodeRecord(const ExecutionRecord &record, unsigned char *out, uint32_t groups = 0);
+    void decodeRecord(const unsigned char *in, ExecutionRecord &record, uint32_t groups = 0);
+
+    // Little-endian helpers, independent of host byte order
+    inline void putU16(unsigned char *p, uint16_t v)
+    {
+        p[0] = (unsigned char)v;
+        p[1] = (unsigned char)(v >> 8);
+    }
+    inline void putU32(unsigned char *p, uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+            p[i] = (unsigned char)(v >> (8 * i));
+    }
+    inline void putU64(unsigned char *p, uint64_t v)
+    {
+        for (int i = 0; i < 8; ++i)
+            p[i] = (unsigned char)(v >> (8 * i));
+    }
+    inline uint16_t getU16(const unsigned char *p)
+    {
+        return (uint16_t)(p[0] | (p[1] << 8));
+    }
+    inline uint32_t getU32(const unsigned char *p)
+    {
+        uint32_t v = 0;
+        for (int i = 3; i >= 0; --i)
+            v = (v << 8) | p[i];
+        return v;
+    }
+    inline uint64_t getU64(const unsigned char *p)
+    {
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; --i)
+            v = (v << 8) | p[i];
+        return v;
+    }
+}
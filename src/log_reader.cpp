@@ -0,0 +1,163 @@
+#include "log_reader.hpp"
+#include <cstring>
+
+namespace
+{
+    constexpr size_t kReadRecords = 4096;
+}
+
+bool LogReader::open(const std::string &filename, std::string &error)
+{
+    in.open(filename, std::ios::in | std::ios::binary);
+    if (!in)
+    {
+        error = "cannot open " + filename;
+        return false;
+    }
+
+    unsigned char raw[binlog::kHeaderSize];
+    in.read(reinterpret_cast<char *>(raw), sizeof(raw));
+    if (!binlog::decodeHeader(raw, (size_t)in.gcount(), file_header))
+    {
+        error = filename + " is not a binary execution log (or has an unsupported version)";
+        return false;
+    }
+
+    // Skip header bytes a newer minor layout may have appended
+    in.seekg(file_header.header_size, std::ios::beg);
+    if (!file_header.compressed())
+        buffer.resize(kReadRecords * file_header.record_size);
+    return true;
+}
+
+bool LogReader::next(ExecutionRecord &record)
+{
+    if (file_header.compressed())
+    {
+        while (block_pos == block_records.size())
+        {
+            if (!readBlock())
+                return false;
+        }
+        record = block_records[block_pos++];
+        return true;
+    }
+
+    if (available - offset < file_header.record_size && !refill())
+        return false;
+    binlog::decodeRecord(buffer.data() + offset, record, file_header.record_groups);
+    offset += file_header.record_size;
+    return true;
+}
+
+bool LogReader::refill()
+{
+    // Carry a partial record over to the front of the buffer
+    size_t leftover = available - offset;
+    std::memmove(buffer.data(), buffer.data() + offset, leftover);
+    in.read(reinterpret_cast<char *>(buffer.data() + leftover), buffer.size() - leftover);
+    available = leftover + (size_t)in.gcount();
+    offset = 0;
+    return available >= file_header.record_size;
+}
+
+bool LogReader::readBlock()
+{
+    unsigned char raw[binlog::kBlockHeaderSize];
+    binlog::BlockHeader header;
+    in.read(reinterpret_cast<char *>(raw), sizeof(raw));
+    if (!binlog::decodeBlockHeader(raw, (size_t)in.gcount(), header))
+        return false;
+
+    buffer.resize(header.stored_size);
+    in.read(reinterpret_cast<char *>(buffer.data()), header.stored_size);
+    if ((size_t)in.gcount() != header.stored_size)
+        return false;
+
+    block_pos = 0;
+    return binlog::decodeBlockPayload(header, buffer.data(), file_header.time_unit_ns, block_records, scratch);
+}
+
+const std::vector<LogReader::BlockInfo> &LogReader::blocks()
+{
+    if (indexed || !file_header.compressed())
+        return block_index;
+
+    // Header walk on a separate position, then restore the stream
+    std::streampos resume = in.tellg();
+    in.clear();
+    uint64_t pos = file_header.header_size;
+    unsigned char raw[binlog::kBlockHeaderSize];
+    while (true)
+    {
+        in.seekg((std::streamoff)pos, std::ios::beg);
+        in.read(reinterpret_cast<char *>(raw), sizeof(raw));
+        BlockInfo info;
+        if (!binlog::decodeBlockHeader(raw, (size_t)in.gcount(), info.header))
+            break;
+        info.offset = pos;
+        pos += binlog::kBlockHeaderSize + info.header.stored_size;
+        block_index.push_back(info);
+    }
+    in.clear();
+    in.seekg(resume);
+    indexed = true;
+    return block_index;
+}
+
+bool LogReader::seekBlock(size_t i)
+{
+    if (!file_header.compressed() || i >= blocks().size())
+        return false;
+    in.clear();
+    in.seekg((std::streamoff)block_index[i].offset, std::ios::beg);
+    block_records.clear();
+    block_pos = 0;
+    return true;
+}
+
+bool LogReader::seekTime(int64_t end_ns)
+{
+    if (!file_header.compressed())
+        return true;
+    const std::vector<BlockInfo> &all = blocks();
+    for (size_t i = 0; i < all.size(); ++i)
+    {
+        if (all[i].header.max_end_ns >= end_ns)
+            return seekBlock(i);
+    }
+    // Nothing that late: position at end so next() returns false
+    in.clear();
+    in.seekg(0, std::ios::end);
+    block_records.clear();
+    block_pos = 0;
+    return true;
+}
+
+bool readExecutionLog(const std::string &path, std::vector<ExecutionRecord> &records, std::string &error)
+{
+    if (resolveLogFormat(LogFormat::Auto, path) != LogFormat::Csv)
+    {
+        LogReader reader;
+        if (!reader.open(path, error))
+            return false;
+        ExecutionRecord record;
+        while (reader.next(record))
+            records.push_back(record);
+        return true;
+    }
+    std::ifstream in(path);
+    if (!in)
+    {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::string line;
+    ExecutionRecord record;
+    while (std::getline(in, line))
+    {
+        if (parseCsvRow(line, record))
+            records.push_back(record);
+    }
+    return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "log_format.hpp"
+#include "log_block.hpp"
+
+// ------------------- Binary Log Reader ---------------------
+// Streams records out of a binary execution log written by Logger, either
+// fixed-width (version 1) or compressed blocks (version 2).
+class LogReader
+{
+public:
+    // Location of one compressed block, for random access
+    struct BlockInfo
+    {
+        uint64_t offset = 0; // file offset of the block header
+        binlog::BlockHeader header;
+    };
+
+    // Returns false (with a message in error) if the file can't be read
+    bool open(const std::string &filename, std::string &error);
+
+    const binlog::Header &header() const { return file_header; }
+
+    // Returns false at end of file; a torn final record or block is ignored
+    bool next(ExecutionRecord &record);
+
+    // Compressed logs only: walks the block headers (skipping payloads)
+    const std::vector<BlockInfo> &blocks();
+
+    // Compressed logs only: continue reading at block i
+    bool seekBlock(size_t i);
+
+    // Continue at the first block that may hold a job ending at or after
+    // end_ns. Fixed-width logs can't skip and stay where they are.
+    bool seekTime(int64_t end_ns);
+
+private:
+    bool refill();
+    bool readBlock();
+
+    std::ifstream in;
+    binlog::Header file_header;
+    std::vector<unsigned char> buffer;
+    size_t offset = 0;
+    size_t available = 0;
+
+    std::vector<ExecutionRecord> block_records;
+    size_t block_pos = 0;
+    std::vector<unsigned char> scratch;
+    std::vector<BlockInfo> block_index;
+    bool indexed = false;
+};
+
+// Every record of a CSV or binary (fixed-width or compressed) log, in log
+// order, which is completion order
+bool readExecutionLog(const std::string &path, std::vector<ExecutionRecord> &records, std::string &error);
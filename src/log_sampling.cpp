@@ -0,0 +1,92 @@
+#include "log_sampling.hpp"
+#include <algorithm>
+
+LogSampler::LogSampler(const LogSampling &config_)
+    : config(config_), rng_state(0x9E3779B97F4A7C15ull)
+{
+    if (config.one_in_n == 0)
+        config.one_in_n = 1;
+    if (config.reservoir_window_ms == 0)
+        config.reservoir_window_ms = 1;
+    reservoir.reserve(config.reservoir_size);
+}
+
+// splitmix64; good enough for sampling and cheaper than <random> engines
+uint64_t LogSampler::random()
+{
+    uint64_t z = (rng_state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+bool LogSampler::admit(const ExecutionRecord &record, std::vector<ExecutionRecord> &released)
+{
+    uint64_t n = seen++;
+    switch (config.mode)
+    {
+    case SamplingMode::All:
+        return true;
+
+    case SamplingMode::OneInN:
+        return (config.keep_anomalies && record.is_anomaly) || n % config.one_in_n == 0;
+
+    case SamplingMode::RateLimited:
+    {
+        const int64_t ns_per_second = 1000000000;
+        int64_t window = record.end_ns / ns_per_second;
+        if (window != rate_window)
+        {
+            rate_window = window;
+            rate_count = 0;
+        }
+        if (config.keep_anomalies && record.is_anomaly)
+            return true;
+        if (rate_count >= config.max_per_second)
+            return false;
+        ++rate_count;
+        return true;
+    }
+
+    case SamplingMode::Reservoir:
+    {
+        const int64_t ns_per_ms = 1000000;
+        int64_t window = record.end_ns / (ns_per_ms * config.reservoir_window_ms);
+        if (window != reservoir_window)
+        {
+            releaseReservoir(released);
+            reservoir_window = window;
+        }
+        if (record.is_anomaly)
+            return true;
+
+        uint64_t k = ++window_normals;
+        if (reservoir.size() < config.reservoir_size)
+            reservoir.emplace_back(n, record);
+        else
+        {
+            uint64_t slot = random() % k;
+            if (slot < config.reservoir_size)
+                reservoir[slot] = {n, record};
+        }
+        return false;
+    }
+    }
+    return true;
+}
+
+void LogSampler::releaseReservoir(std::vector<ExecutionRecord> &released)
+{
+    std::sort(reservoir.begin(), reservoir.end(),
+              [](const auto &a, const auto &b)
+              { return a.first < b.first; });
+    for (auto &held : reservoir)
+        released.push_back(held.second);
+    reservoir.clear();
+    window_normals = 0;
+}
+
+void LogSampler::drain(std::vector<ExecutionRecord> &released)
+{
+    releaseReservoir(released);
+}
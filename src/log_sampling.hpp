@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "log_format.hpp"
+
+// ------------------- Log Sampling ---------------------
+// Decides which execution records Logger persists. Sampling only affects
+// what reaches the file: the real-time detector and the queue-wait EWMA
+// still see every job.
+
+enum class SamplingMode
+{
+    All,          // persist every record
+    OneInN,       // every one_in_n-th record
+    RateLimited,  // at most max_per_second records per second of job end time
+    Reservoir     // anomalies, plus a uniform sample of reservoir_size normals per window
+};
+
+struct LogSampling
+{
+    SamplingMode mode = SamplingMode::All;
+    uint32_t one_in_n = 100;
+    uint32_t max_per_second = 10000;
+    uint32_t reservoir_size = 1024;
+    uint32_t reservoir_window_ms = 1000;
+    bool keep_anomalies = true; // OneInN/RateLimited: anomalies bypass the sample
+};
+
+class LogSampler
+{
+    LogSampling config;
+    uint64_t seen = 0;
+
+    // RateLimited: records admitted in the current one-second window
+    int64_t rate_window = 0;
+    uint32_t rate_count = 0;
+
+    // Reservoir: Algorithm R over the normals of the current window
+    int64_t reservoir_window = 0;
+    uint64_t window_normals = 0;
+    std::vector<std::pair<uint64_t, ExecutionRecord>> reservoir; // (arrival, record)
+    uint64_t rng_state;
+
+    uint64_t random();
+    void releaseReservoir(std::vector<ExecutionRecord> &released);
+
+public:
+    explicit LogSampler(const LogSampling &config);
+
+    // True if record should be persisted now. In Reservoir mode a normal
+    // record may instead be held back; records from a finished window are
+    // appended to released, in arrival order.
+    bool admit(const ExecutionRecord &record, std::vector<ExecutionRecord> &released);
+
+    // Releases any held-back records (on flush, rotation and shutdown)
+    void drain(std::vector<ExecutionRecord> &released);
+};
@@ -0,0 +1,149 @@
+#include "log_segments.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+    // Splits "dir/name.ext" into "dir/name" and ".ext"
+    void splitExtension(const std::string &base, std::string &stem, std::string &ext)
+    {
+        size_t slash = base.find_last_of("/\\");
+        size_t dot = base.find_last_of('.');
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        {
+            stem = base;
+            ext.clear();
+        }
+        else
+        {
+            stem = base.substr(0, dot);
+            ext = base.substr(dot);
+        }
+    }
+}
+
+void SegmentIndex::add(const ExecutionRecord &record)
+{
+    if (records == 0)
+        first_job_id = record.job_id;
+    ++records;
+    last_job_id = record.job_id;
+    min_job_id = std::min(min_job_id, record.job_id);
+    max_job_id = std::max(max_job_id, record.job_id);
+    min_start_ns = std::min(min_start_ns, record.start_ns);
+    max_end_ns = std::max(max_end_ns, record.end_ns);
+}
+
+std::string segmentPath(const std::string &base, unsigned number)
+{
+    std::string stem, ext;
+    splitExtension(base, stem, ext);
+    char digits[16];
+    std::snprintf(digits, sizeof(digits), ".%06u", number);
+    return stem + digits + ext;
+}
+
+std::string segmentIndexPath(const std::string &segment_path)
+{
+    return segment_path + ".idx";
+}
+
+std::vector<unsigned> listSegments(const std::string &base)
+{
+    std::string stem, ext;
+    splitExtension(base, stem, ext);
+    fs::path stem_path(stem);
+    fs::path dir = stem_path.parent_path().empty() ? fs::path(".") : stem_path.parent_path();
+    std::string prefix = stem_path.filename().string() + ".";
+
+    std::vector<unsigned> numbers;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+    {
+        std::string name = it->path().filename().string();
+        if (name.size() != prefix.size() + 6 + ext.size() ||
+            name.compare(0, prefix.size(), prefix) != 0 ||
+            name.compare(name.size() - ext.size(), ext.size(), ext) != 0)
+            continue;
+        std::string digits = name.substr(prefix.size(), 6);
+        if (digits.find_first_not_of("0123456789") != std::string::npos)
+            continue;
+        numbers.push_back((unsigned)std::stoul(digits));
+    }
+    std::sort(numbers.begin(), numbers.end());
+    return numbers;
+}
+
+bool writeSegmentIndex(const std::string &path, const SegmentIndex &index)
+{
+    // Written to a temporary name and renamed, so readers never see half an index
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::out | std::ios::trunc);
+        out << "segment=" << index.segment << "\n"
+            << "records=" << index.records << "\n"
+            << "first_job_id=" << index.first_job_id << "\n"
+            << "last_job_id=" << index.last_job_id << "\n"
+            << "min_job_id=" << index.min_job_id << "\n"
+            << "max_job_id=" << index.max_job_id << "\n"
+            << "min_start_ns=" << index.min_start_ns << "\n"
+            << "max_end_ns=" << index.max_end_ns << "\n";
+        if (!out)
+            return false;
+    }
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    return !ec;
+}
+
+bool readSegmentIndex(const std::string &path, SegmentIndex &index)
+{
+    std::ifstream in(path);
+    if (!in)
+        return false;
+    index = SegmentIndex();
+    std::string line;
+    while (std::getline(in, line))
+    {
+        size_t eq = line.find('=');
+        if (eq == std::string::npos)
+            continue;
+        std::string key = line.substr(0, eq);
+        std::istringstream value(line.substr(eq + 1));
+        if (key == "segment")
+            index.segment = line.substr(eq + 1);
+        else if (key == "records")
+            value >> index.records;
+        else if (key == "first_job_id")
+            value >> index.first_job_id;
+        else if (key == "last_job_id")
+            value >> index.last_job_id;
+        else if (key == "min_job_id")
+            value >> index.min_job_id;
+        else if (key == "max_job_id")
+            value >> index.max_job_id;
+        else if (key == "min_start_ns")
+            value >> index.min_start_ns;
+        else if (key == "max_end_ns")
+            value >> index.max_end_ns;
+    }
+    return true;
+}
+
+std::vector<std::string> selectSegments(const std::string &base, int64_t from_ns, int64_t to_ns)
+{
+    std::vector<std::string> selected;
+    for (unsigned number : listSegments(base))
+    {
+        std::string path = segmentPath(base, number);
+        SegmentIndex index;
+        if (!readSegmentIndex(segmentIndexPath(path), index) || index.overlaps(from_ns, to_ns))
+            selected.push_back(path);
+    }
+    return selected;
+}
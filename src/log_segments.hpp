@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+#include "log_format.hpp"
+
+// ------------------- Log Segments ---------------------
+// A rotating Logger writes "execution_log.csv" as numbered segments
+// ("execution_log.000001.csv", ...), each closed with a small text index
+// ("execution_log.000001.csv.idx") so tools can pick the segments that
+// overlap a time range without opening them.
+
+struct LogRotation
+{
+    uint64_t max_segment_bytes = 0; // 0 = no size limit
+    int64_t max_segment_seconds = 0; // 0 = no time limit
+    bool append = false;             // keep existing log/segments instead of truncating
+
+    bool enabled() const { return max_segment_bytes > 0 || max_segment_seconds > 0; }
+};
+
+struct SegmentIndex
+{
+    std::string segment; // file name of the segment, without directory
+    uint64_t records = 0;
+    uint64_t first_job_id = 0;
+    uint64_t last_job_id = 0;
+    uint64_t min_job_id = std::numeric_limits<uint64_t>::max();
+    uint64_t max_job_id = 0;
+    int64_t min_start_ns = std::numeric_limits<int64_t>::max();
+    int64_t max_end_ns = std::numeric_limits<int64_t>::min();
+
+    void add(const ExecutionRecord &record);
+
+    // True if the segment's [min start, max end] range overlaps [from_ns, to_ns]
+    bool overlaps(int64_t from_ns, int64_t to_ns) const
+    {
+        return records > 0 && min_start_ns <= to_ns && max_end_ns >= from_ns;
+    }
+};
+
+// "dir/execution_log.csv", 3 -> "dir/execution_log.000003.csv"
+std::string segmentPath(const std::string &base, unsigned number);
+std::string segmentIndexPath(const std::string &segment_path);
+
+// Segment numbers that exist on disk for base, ascending
+std::vector<unsigned> listSegments(const std::string &base);
+
+bool writeSegmentIndex(const std::string &path, const SegmentIndex &index);
+bool readSegmentIndex(const std::string &path, SegmentIndex &index);
+
+// Segment files of base that may hold jobs started within [from_ns, to_ns].
+// Segments without a readable index (e.g. the one open at a crash) are kept.
+std::vector<std::string> selectSegments(const std::string &base, int64_t from_ns, int64_t to_ns);
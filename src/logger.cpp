@@ -0,0 +1,427 @@
+#include "logger.hpp"
+#include "log_block.hpp"
+#include <iostream>
+#include <numeric>
+#include <cmath> // Add this line for std::sqrt
+#include <cstdio>
+
+Logger::Logger(const std::string &filename, LogFormat format_, int thread_count_,
+               const LogRotation &rotation_, const LogSampling &sampling, uint32_t record_groups_)
+    : format(resolveLogFormat(format_, filename)), record_groups(record_groups_),
+      record_size(binlog::kRecordSize + binlog::groupRecordSize(record_groups_)), base_filename(filename),
+      thread_count(thread_count_), rotation(rotation_), sampler(sampling)
+{
+    detector = std::make_unique<ZScoreDetector>();
+    if (format == LogFormat::Binary)
+        pending.reserve(kBinaryFlushBytes + record_size);
+    if (format == LogFormat::CompressedBinary)
+    {
+        block.reserve(binlog::kDefaultBlockRecords);
+        writer = std::thread(&Logger::writerLoop, this);
+    }
+
+    if (!rotation.enabled())
+    {
+        openFile(filename, rotation.append);
+        return;
+    }
+
+    std::vector<unsigned> existing = listSegments(base_filename);
+    if (rotation.append)
+    {
+        // Continue numbering after the previous run's segments
+        segment_number = existing.empty() ? 0 : existing.back();
+    }
+    else
+    {
+        // Same semantics as truncating a single file: drop the old run
+        for (unsigned number : existing)
+        {
+            std::string path = segmentPath(base_filename, number);
+            std::remove(path.c_str());
+            std::remove(segmentIndexPath(path).c_str());
+        }
+    }
+    openSegment();
+}
+
+Logger::~Logger()
+{
+    {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        sampler.drain(released);
+        persistReleased();
+        if (segment_number > 0)
+            closeSegment();
+        else
+        {
+            flushPending();
+            drainWriter();
+        }
+    }
+    if (writer.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            writer_stop = true;
+        }
+        writer_wake.notify_one();
+        writer.join();
+    }
+    if (log_file.is_open())
+        log_file.close();
+}
+
+void Logger::openFile(const std::string &path, bool append)
+{
+    bool has_header = false;
+    if (append)
+    {
+        // Only append to a file that already starts with our header
+        std::ifstream existing(path, std::ios::in | std::ios::binary);
+        if (format != LogFormat::Csv)
+        {
+            unsigned char raw[binlog::kHeaderSize];
+            binlog::Header header;
+            existing.read(reinterpret_cast<char *>(raw), sizeof(raw));
+            has_header = binlog::decodeHeader(raw, (size_t)existing.gcount(), header) &&
+                         header.compressed() == (format == LogFormat::CompressedBinary) &&
+                         header.record_groups == record_groups && header.record_size == record_size;
+        }
+        else
+        {
+            std::string first_line;
+            has_header = std::getline(existing, first_line) && first_line == csvHeader(record_groups);
+        }
+    }
+
+    std::ios::openmode mode = std::ios::out;
+    if (format != LogFormat::Csv)
+        mode |= std::ios::binary;
+    mode |= has_header ? std::ios::app : std::ios::trunc;
+    log_file.open(path, mode);
+    segment_bytes = 0;
+    if (has_header)
+        return;
+
+    if (format != LogFormat::Csv)
+    {
+        binlog::Header file_header = binlog::makeHeader(thread_count);
+        file_header.record_groups = record_groups;
+        file_header.record_size = (uint16_t)record_size;
+        if (format == LogFormat::CompressedBinary)
+        {
+            file_header.version = binlog::kCompressedVersion;
+            file_header.time_unit_ns = binlog::kDefaultTimeUnitNs;
+            file_header.block_records = binlog::kDefaultBlockRecords;
+        }
+        unsigned char header[binlog::kHeaderSize];
+        binlog::encodeHeader(file_header, header);
+        log_file.write(reinterpret_cast<const char *>(header), sizeof(header));
+        segment_bytes = sizeof(header);
+    }
+    else
+    {
+        writeCsvHeader(log_file, record_groups);
+        segment_bytes = (uint64_t)log_file.tellp();
+    }
+}
+
+void Logger::openSegment()
+{
+    ++segment_number;
+    std::string path = segmentPath(base_filename, segment_number);
+    openFile(path, false);
+    segment_opened = std::chrono::steady_clock::now();
+    segment_index = SegmentIndex();
+    size_t slash = path.find_last_of("/\\");
+    segment_index.segment = slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+void Logger::closeSegment()
+{
+    flushPending();
+    drainWriter();
+    log_file.close();
+    writeSegmentIndex(segmentIndexPath(segmentPath(base_filename, segment_number)), segment_index);
+}
+
+bool Logger::segmentFull() const
+{
+    if (segment_index.records == 0)
+        return false;
+    if (rotation.max_segment_bytes > 0 && segment_bytes >= rotation.max_segment_bytes)
+        return true;
+    return rotation.max_segment_seconds > 0 &&
+           std::chrono::steady_clock::now() - segment_opened >= std::chrono::seconds(rotation.max_segment_seconds);
+}
+
+void Logger::log(uint64_t job_id, int thread_id,
+                 std::chrono::high_resolution_clock::time_point submit_time,
+                 std::chrono::high_resolution_clock::time_point start_time,
+                 std::chrono::high_resolution_clock::time_point end_time,
+                 int preferred_thread)
+{
+    using namespace std::chrono;
+
+    ExecutionRecord record;
+    record.job_id = job_id;
+    record.thread_id = thread_id;
+    record.preferred_thread = preferred_thread;
+    record.submit_ns = duration_cast<nanoseconds>(submit_time.time_since_epoch()).count();
+    record.start_ns = duration_cast<nanoseconds>(start_time.time_since_epoch()).count();
+    record.end_ns = duration_cast<nanoseconds>(end_time.time_since_epoch()).count();
+    log(record);
+}
+
+bool Logger::log(ExecutionRecord record)
+{
+    const int64_t ns_per_ms = 1000000;
+
+    std::lock_guard<std::mutex> lock(log_mutex);
+
+    auto exec_duration = record.end_ns / ns_per_ms - record.start_ns / ns_per_ms;
+
+    bool memory_anomaly = false;
+    if (record.groups & kGroupAlloc)
+    {
+        double peak = double(record.alloc_peak_bytes);
+        memory_anomaly = detectMemoryAnomaly(peak);
+        alloc_peak_history.push_back(peak);
+        if (alloc_peak_history.size() > max_history)
+            alloc_peak_history.erase(alloc_peak_history.begin());
+    }
+
+    record.is_anomaly = detector->observe(double(exec_duration)) || memory_anomaly;
+    if (memory_anomaly)
+        record.anomaly_kind = AnomalyKind::Memory;
+    else
+        record.anomaly_kind = record.is_anomaly ? classifyAnomaly(record) : AnomalyKind::None;
+
+    addQueueWait(double(record.start_ns - record.submit_ns) / ns_per_ms);
+
+    const auto relaxed = std::memory_order_relaxed;
+    seen_count.store(seen_count.load(relaxed) + 1, relaxed);
+    if (record.is_anomaly)
+    {
+        anomaly_count.store(anomaly_count.load(relaxed) + 1, relaxed);
+        std::atomic<uint64_t> &kind = anomaly_kind_counts[(int)record.anomaly_kind];
+        kind.store(kind.load(relaxed) + 1, relaxed);
+    }
+    bool keep = sampler.admit(record, released);
+    persistReleased();
+    if (keep)
+        persist(record);
+
+    if (record.is_anomaly && print_anomalies)
+    {
+        std::cout << "🚨 REAL-TIME ANOMALY DETECTED: Job " << record.job_id
+                  << " took " << exec_duration << "ms (Thread " << record.thread_id;
+        if (record.anomaly_kind != AnomalyKind::None)
+            std::cout << ", " << anomalyKindName(record.anomaly_kind);
+        std::cout << ")\n";
+    }
+    return record.is_anomaly;
+}
+
+// Also called by producers outside log_mutex, hence the CAS loop
+void Logger::addQueueWait(double wait_ms)
+{
+    double ewma = queue_wait_ewma_ms.load(std::memory_order_relaxed);
+    while (!queue_wait_ewma_ms.compare_exchange_weak(ewma, ewma + queue_wait_alpha * (wait_ms - ewma),
+                                                     std::memory_order_relaxed))
+    {
+    }
+}
+
+void Logger::persist(const ExecutionRecord &record)
+{
+    persisted_count.store(persisted_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (segment_number > 0)
+    {
+        if (segmentFull())
+        {
+            closeSegment();
+            openSegment();
+        }
+        segment_index.add(record);
+    }
+
+    if (format == LogFormat::CompressedBinary)
+    {
+        block.push_back(record);
+        if (block.size() >= binlog::kDefaultBlockRecords)
+            flushPending();
+    }
+    else if (format == LogFormat::Binary)
+    {
+        size_t offset = pending.size();
+        pending.resize(offset + record_size);
+        binlog::encodeRecord(record, pending.data() + offset, record_groups);
+        segment_bytes += record_size;
+        if (pending.size() >= kBinaryFlushBytes)
+            flushPending();
+    }
+    else
+    {
+        writeCsvRow(log_file, record, record_groups);
+        log_file.flush();
+        segment_bytes = (uint64_t)log_file.tellp();
+    }
+}
+
+// Writes the reservoir samples the sampler let go of
+void Logger::persistReleased()
+{
+    for (const ExecutionRecord &record : released)
+        persist(record);
+    released.clear();
+}
+
+LogStats Logger::stats() const
+{
+    const auto relaxed = std::memory_order_relaxed;
+    LogStats stats;
+    stats.seen = seen_count.load(relaxed);
+    stats.persisted = persisted_count.load(relaxed);
+    stats.anomalies = anomaly_count.load(relaxed);
+    for (int kind = 0; kind < kAnomalyKindCount; ++kind)
+        stats.anomaly_kinds[kind] = anomaly_kind_counts[kind].load(relaxed);
+    return stats;
+}
+
+void Logger::flush()
+{
+    std::lock_guard<std::mutex> lock(log_mutex);
+    sampler.drain(released);
+    persistReleased();
+    flushPending();
+    drainWriter();
+    log_file.flush();
+    // Keep the open segment's index current so tools can use it before rotation
+    if (segment_number > 0 && segment_index.records > 0)
+        writeSegmentIndex(segmentIndexPath(segmentPath(base_filename, segment_number)), segment_index);
+}
+
+void Logger::flushPending()
+{
+    if (!block.empty())
+    {
+        // Hand the block to the writer; a fresh one keeps its capacity
+        std::vector<ExecutionRecord> full;
+        full.reserve(binlog::kDefaultBlockRecords);
+        full.swap(block);
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            writer_queue.push_back(std::move(full));
+        }
+        writer_wake.notify_one();
+    }
+    if (pending.empty())
+        return;
+    log_file.write(reinterpret_cast<const char *>(pending.data()), pending.size());
+    pending.clear();
+}
+
+void Logger::writerLoop()
+{
+    std::vector<unsigned char> encoded;
+    std::unique_lock<std::mutex> lock(writer_mutex);
+    while (true)
+    {
+        writer_wake.wait(lock, [this]
+                         { return !writer_queue.empty() || writer_stop; });
+        if (writer_queue.empty())
+            return;
+
+        std::vector<ExecutionRecord> records = std::move(writer_queue.front());
+        writer_queue.pop_front();
+        writer_busy = true;
+        lock.unlock();
+
+        encoded.clear();
+        binlog::encodeBlock(records, binlog::kDefaultTimeUnitNs, encoded);
+        log_file.write(reinterpret_cast<const char *>(encoded.data()), encoded.size());
+        segment_bytes += encoded.size();
+
+        lock.lock();
+        writer_busy = false;
+        if (writer_queue.empty())
+            writer_drained.notify_all();
+    }
+}
+
+// Waits until every queued block is on disk; log_file is then safe to touch
+void Logger::drainWriter()
+{
+    if (!writer.joinable())
+        return;
+    std::unique_lock<std::mutex> lock(writer_mutex);
+    writer_drained.wait(lock, [this]
+                        { return writer_queue.empty() && !writer_busy; });
+}
+
+void Logger::setDetector(std::unique_ptr<AnomalyDetector> replacement)
+{
+    std::lock_guard<std::mutex> lock(log_mutex);
+    detector = replacement ? std::move(replacement) : std::make_unique<ZScoreDetector>();
+}
+
+void Logger::setPrintAnomalies(bool enabled)
+{
+    std::lock_guard<std::mutex> lock(log_mutex);
+    print_anomalies = enabled;
+}
+
+// A heap peak far above recent jobs' is an anomaly even if the job was not
+// slow. Most jobs allocate next to nothing, so the spread is often zero;
+// the floor keeps a few stray kilobytes from counting.
+bool Logger::detectMemoryAnomaly(double peak_bytes) const
+{
+    if (alloc_peak_history.size() < 10 || peak_bytes < memory_min_peak_bytes)
+        return false;
+
+    double mean = std::accumulate(alloc_peak_history.begin(), alloc_peak_history.end(), 0.0) /
+                  alloc_peak_history.size();
+    double variance = 0.0;
+    for (double peak : alloc_peak_history)
+        variance += (peak - mean) * (peak - mean);
+    variance /= alloc_peak_history.size();
+
+    return peak_bytes > mean + memory_z_threshold * std::sqrt(variance);
+}
+
+// Memory first: a job that faults in a large buffer and then waits is still
+// a memory anomaly. Then time blocked on instrumented locks, which would
+// otherwise just look blocked. Otherwise the share of wall time spent on CPU separates
+// compute from blocking: measured by the thread CPU clock or the task
+// clock, else estimated from cycles per nanosecond (>= ~1 at any realistic
+// clock), else any context switch inside the job counts as blocking.
+AnomalyKind Logger::classifyAnomaly(const ExecutionRecord &record) const
+{
+    auto has = [&record](PerfCounter counter)
+    { return (record.groups & kGroupPerf) && (record.perf_valid & (1u << counter)) != 0; };
+
+    if (has(kPerfPageFaults) && record.perf[kPerfPageFaults] >= memory_page_faults)
+        return AnomalyKind::Memory;
+    if (has(kPerfLlcMisses) && has(kPerfInstructions) && record.perf[kPerfInstructions] > 0 &&
+        1000.0 * record.perf[kPerfLlcMisses] / record.perf[kPerfInstructions] >= memory_llc_mpki)
+        return AnomalyKind::Memory;
+
+    int64_t wall_ns = record.end_ns - record.start_ns;
+    if ((record.groups & kGroupLock) && wall_ns > 0 &&
+        double(record.lock_wait_ns) / wall_ns >= contention_wait_ratio)
+        return AnomalyKind::Contention;
+    if (record.groups & kGroupCpu)
+        return record.on_cpu_permille < blocked_on_cpu_ratio * 1000 ? AnomalyKind::Blocked
+                                                                    : AnomalyKind::Compute;
+    if (has(kPerfTaskClock) && wall_ns > 0)
+        return double(record.perf[kPerfTaskClock]) / wall_ns < blocked_on_cpu_ratio ? AnomalyKind::Blocked
+                                                                                   : AnomalyKind::Compute;
+    if (has(kPerfCycles) && wall_ns > 0)
+        return double(record.perf[kPerfCycles]) / wall_ns < blocked_cycles_per_ns ? AnomalyKind::Blocked
+                                                                                 : AnomalyKind::Compute;
+    if (has(kPerfContextSwitches))
+        return record.perf[kPerfContextSwitches] > 0 ? AnomalyKind::Blocked : AnomalyKind::Compute;
+    return AnomalyKind::None;
+}
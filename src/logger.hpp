@@ -3,87 +3,136 @@
 #include <mutex>
 #include <string>
 #include <chrono>
-#include <iomanip>
 #include <vector>
-#include <numeric>
-#include <iostream>
-#include <cmath> // Add this line for std::sqrt
+#include <atomic>
+#include <cstdint>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <memory>
+#include "anomaly_detector.hpp"
+#include "log_format.hpp"
+#include "log_segments.hpp"
+#include "log_sampling.hpp"
+
+struct LogStats
+{
+    uint64_t seen = 0;      // records passed to the detector
+    uint64_t persisted = 0; // records written after sampling
+    uint64_t anomalies = 0; // records the real-time detector flagged
+    uint64_t anomaly_kinds[kAnomalyKindCount] = {}; // flagged records by AnomalyKind; [None] = unclassified
+};
 
 class Logger
 {
-    std::mutex log_mutex;
+    mutable std::mutex log_mutex;
     std::ofstream log_file;
-    std::vector<double> execution_history;
+    std::unique_ptr<AnomalyDetector> detector; // judges execution times; ZScoreDetector by default
+    bool print_anomalies = true;               // report flagged jobs on std::cout
     size_t max_history = 50;
 
+    // Anomaly classification from resource counters (see classifyAnomaly)
+    uint64_t memory_page_faults = 256;   // ~1 MB of freshly touched pages
+    double memory_llc_mpki = 10.0;       // LLC misses per 1000 instructions
+    double blocked_on_cpu_ratio = 0.5;   // CPU time / wall time below this = blocked
+    double blocked_cycles_per_ns = 0.5;  // same, when only cycles are available
+    double contention_wait_ratio = 0.5;  // anomsched::mutex wait / wall time at or above this
+
+    // Memory detector over the peak heap use of jobs with kGroupAlloc
+    std::vector<double> alloc_peak_history;
+    double memory_z_threshold = 3.0;
+    uint64_t memory_min_peak_bytes = 1 << 20; // smaller peaks are never anomalous
+
+    // Smoothed queue wait, read lock-free by the scheduler's admission control
+    std::atomic<double> queue_wait_ewma_ms{0.0};
+    double queue_wait_alpha = 0.1;
+
+    // Binary records are batched and written in large chunks
+    LogFormat format;
+    uint32_t record_groups; // optional kGroup* columns this log carries
+    size_t record_size;     // binary record size including the groups
+    std::vector<unsigned char> pending;
+    static constexpr size_t kBinaryFlushBytes = 64 * 1024;
+
+    // Compressed logs: full blocks are encoded and written by a background
+    // thread so compression never runs under log_mutex
+    std::vector<ExecutionRecord> block;
+    std::thread writer;
+    std::mutex writer_mutex;
+    std::condition_variable writer_wake;
+    std::condition_variable writer_drained;
+    std::deque<std::vector<ExecutionRecord>> writer_queue;
+    bool writer_busy = false;
+    bool writer_stop = false;
+
+    // Segment rotation; segment_number stays 0 when rotation is off
+    std::string base_filename;
+    int thread_count;
+    LogRotation rotation;
+    unsigned segment_number = 0;
+    std::atomic<uint64_t> segment_bytes{0}; // also advanced by the writer thread
+    std::chrono::steady_clock::time_point segment_opened;
+    SegmentIndex segment_index;
+
+    // Sampling decides what is persisted; detection always sees every record
+    LogSampler sampler;
+    std::vector<ExecutionRecord> released;
+
+    // LogStats, written under log_mutex but read by stats() without it so
+    // polling a snapshot never contends with completing jobs
+    std::atomic<uint64_t> seen_count{0};
+    std::atomic<uint64_t> persisted_count{0};
+    std::atomic<uint64_t> anomaly_count{0};
+    std::atomic<uint64_t> anomaly_kind_counts[kAnomalyKindCount] = {};
+
 public:
-    Logger(const std::string &filename)
-    {
-        log_file.open(filename, std::ios::out);
-        log_file << "JobID,ThreadID,SubmitTime,StartTime,EndTime,ExecDurationMS,QueueWaitMS,IsAnomaly\n";
-    }
+    Logger(const std::string &filename, LogFormat format = LogFormat::Auto, int thread_count = 0,
+           const LogRotation &rotation = LogRotation(), const LogSampling &sampling = LogSampling(),
+           uint32_t record_groups = 0);
+    ~Logger();
 
-    ~Logger()
-    {
-        if (log_file.is_open())
-            log_file.close();
-    }
+    // Runs the real-time detector on the record, then persists it if sampled.
+    // Returns the detector's verdict.
+    bool log(ExecutionRecord record);
 
-    void log(int job_id, int thread_id,
+    void log(uint64_t job_id, int thread_id,
              std::chrono::high_resolution_clock::time_point submit_time,
              std::chrono::high_resolution_clock::time_point start_time,
-             std::chrono::high_resolution_clock::time_point end_time)
-    {
-        using namespace std::chrono;
-
-        std::lock_guard<std::mutex> lock(log_mutex);
+             std::chrono::high_resolution_clock::time_point end_time,
+             int preferred_thread = -1);
 
-        auto submit_ms = duration_cast<milliseconds>(submit_time.time_since_epoch()).count();
-        auto start_ms = duration_cast<milliseconds>(start_time.time_since_epoch()).count();
-        auto end_ms = duration_cast<milliseconds>(end_time.time_since_epoch()).count();
+    void flush();
 
-        auto exec_duration = end_ms - start_ms;
-        auto queue_wait = start_ms - submit_ms;
+    // Replaces the execution-time detector; null restores the default
+    void setDetector(std::unique_ptr<AnomalyDetector> replacement);
 
-        bool is_anomaly = detectAnomalyRealTime(exec_duration);
+    // Whether flagged jobs are reported on std::cout (default true)
+    void setPrintAnomalies(bool enabled);
 
-        execution_history.push_back(exec_duration);
-        if (execution_history.size() > max_history)
-        {
-            execution_history.erase(execution_history.begin());
-        }
+    // Lock-free; counters read mid-update may be a job apart from each other
+    LogStats stats() const;
 
-        log_file << job_id << "," << thread_id << ","
-                 << submit_ms << "," << start_ms << "," << end_ms << ","
-                 << exec_duration << "," << queue_wait << ","
-                 << (is_anomaly ? "1" : "0") << "\n";
-        log_file.flush();
-
-        if (is_anomaly)
-        {
-            std::cout << "🚨 REAL-TIME ANOMALY DETECTED: Job " << job_id
-                      << " took " << exec_duration << "ms (Thread " << thread_id << ")\n";
-        }
-    }
-
-private:
-    bool detectAnomalyRealTime(double current_duration)
+    // Exponentially weighted queue wait of recently completed jobs
+    double recentQueueWaitMS() const
     {
-        if (execution_history.size() < 10)
-            return false;
-
-        double mean = std::accumulate(execution_history.begin(), execution_history.end(), 0.0) / execution_history.size();
-
-        double variance = 0.0;
-        for (double duration : execution_history)
-        {
-            variance += (duration - mean) * (duration - mean);
-        }
-        variance /= execution_history.size();
-        double std_dev = std::sqrt(variance); // std::sqrt now available
+        return queue_wait_ewma_ms.load(std::memory_order_relaxed);
+    }
 
-        double z_score = std::abs((current_duration - mean) / std_dev);
+    // An empty queue means a new job would not wait: moves the average one
+    // step towards zero, so shedding recovers even when nothing completes
+    void noteEmptyQueue() { addQueueWait(0.0); }
 
-        return z_score > 2.0;
-    }
+private:
+    void addQueueWait(double wait_ms);
+    bool detectMemoryAnomaly(double peak_bytes) const;
+    AnomalyKind classifyAnomaly(const ExecutionRecord &record) const;
+    void persist(const ExecutionRecord &record);
+    void persistReleased();
+    void flushPending();
+    void writerLoop();
+    void drainWriter();
+    void openFile(const std::string &path, bool append);
+    void openSegment();
+    void closeSegment();
+    bool segmentFull() const;
 };
@@ -0,0 +1,135 @@
+#include "lz.hpp"
+#include <cstring>
+
+namespace
+{
+    constexpr size_t kMinMatch = 4;
+    constexpr size_t kMaxOffset = 65535;
+    constexpr int kHashBits = 14;
+
+    inline uint32_t read32(const unsigned char *p)
+    {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    inline uint32_t hash4(uint32_t v)
+    {
+        return (v * 2654435761u) >> (32 - kHashBits);
+    }
+
+    void putLength(std::vector<unsigned char> &out, size_t length)
+    {
+        while (length >= 255)
+        {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back((unsigned char)length);
+    }
+
+    void emitSequence(std::vector<unsigned char> &out, const unsigned char *literals, size_t literal_length,
+                      size_t offset, size_t match_length)
+    {
+        size_t match_code = match_length ? match_length - kMinMatch : 0;
+        unsigned char token = (unsigned char)(((literal_length < 15 ? literal_length : 15) << 4) |
+                                              (match_code < 15 ? match_code : 15));
+        out.push_back(token);
+        if (literal_length >= 15)
+            putLength(out, literal_length - 15);
+        out.insert(out.end(), literals, literals + literal_length);
+        if (match_length == 0)
+            return; // final, literal-only sequence
+        out.push_back((unsigned char)offset);
+        out.push_back((unsigned char)(offset >> 8));
+        if (match_code >= 15)
+            putLength(out, match_code - 15);
+    }
+
+    bool getLength(const unsigned char *&p, const unsigned char *end, size_t &length)
+    {
+        unsigned char b;
+        do
+        {
+            if (p >= end)
+                return false;
+            b = *p++;
+            length += b;
+        } while (b == 255);
+        return true;
+    }
+}
+
+namespace lz
+{
+    void compress(const unsigned char *in, size_t size, std::vector<unsigned char> &out)
+    {
+        std::vector<uint32_t> table(size_t(1) << kHashBits, 0);
+        size_t anchor = 0; // start of pending literals
+        size_t pos = 0;
+
+        while (size >= kMinMatch && pos + kMinMatch <= size)
+        {
+            uint32_t h = hash4(read32(in + pos));
+            size_t candidate = table[h];
+            table[h] = (uint32_t)pos;
+
+            if (candidate < pos && pos - candidate <= kMaxOffset &&
+                read32(in + candidate) == read32(in + pos))
+            {
+                size_t length = kMinMatch;
+                while (pos + length < size && in[candidate + length] == in[pos + length])
+                    ++length;
+                emitSequence(out, in + anchor, pos - anchor, pos - candidate, length);
+                pos += length;
+                anchor = pos;
+            }
+            else
+            {
+                ++pos;
+            }
+        }
+        emitSequence(out, in + anchor, size - anchor, 0, 0);
+    }
+
+    bool decompress(const unsigned char *in, size_t size, size_t raw_size, std::vector<unsigned char> &out)
+    {
+        out.clear();
+        out.reserve(raw_size);
+        const unsigned char *p = in;
+        const unsigned char *end = in + size;
+
+        while (p < end)
+        {
+            unsigned char token = *p++;
+            size_t literal_length = token >> 4;
+            if (literal_length == 15 && !getLength(p, end, literal_length))
+                return false;
+            if ((size_t)(end - p) < literal_length || out.size() + literal_length > raw_size)
+                return false;
+            out.insert(out.end(), p, p + literal_length);
+            p += literal_length;
+
+            if (p == end)
+                break; // final sequence carries no match
+
+            if (end - p < 2)
+                return false;
+            size_t offset = p[0] | (size_t(p[1]) << 8);
+            p += 2;
+            size_t match_length = token & 15;
+            if (match_length == 15 && !getLength(p, end, match_length))
+                return false;
+            match_length += kMinMatch;
+            if (offset == 0 || offset > out.size() || out.size() + match_length > raw_size)
+                return false;
+
+            // Byte by byte: matches may overlap their own output
+            size_t from = out.size() - offset;
+            for (size_t i = 0; i < match_length; ++i)
+                out.push_back(out[from + i]);
+        }
+        return out.size() == raw_size;
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ------------------- In-tree LZ Compressor ---------------------
+// A small LZ77 block compressor in the style of LZ4's block format:
+// sequences of [token][literal length+][literals][u16 offset][match length+]
+// where the token packs the literal length (high nibble) and match length
+// minus 4 (low nibble), with 15 meaning "more length bytes follow".
+// Good enough for log blocks without pulling in an external dependency.
+namespace lz
+{
+    // Appends the compressed form of in[0, size) to out
+    void compress(const unsigned char *in, size_t size, std::vector<unsigned char> &out);
+
+    // Decompresses exactly raw_size bytes; returns false on malformed input
+    bool decompress(const unsigned char *in, size_t size, size_t raw_size, std::vector<unsigned char> &out);
+}
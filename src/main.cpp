@@ -1,4 +1,6 @@
 #include "scheduler.hpp"
+#include "lock_profiler.hpp"
+#include "log_reader.hpp"
 #include <iostream>
 #include <vector>
 #include <thread>
@@ -40,6 +42,10 @@ void advancedStressTest(Scheduler &scheduler, int jobCount)
     {
         int anomaly_type = i % 20;
 
+        // Tag injected anomalies (classes 1-4) so detectors can be scored against them
+        JobOptions job_options;
+        job_options.job_class = anomaly_type < 4 ? (uint8_t)(anomaly_type + 1) : 0;
+
         scheduler.submitJob([i, anomaly_type]()
                             {
             switch (anomaly_type) {
@@ -65,8 +71,8 @@ void advancedStressTest(Scheduler &scheduler, int jobCount)
                     
                 case 3: { // Thread contention anomaly - add braces
                     std::cout << "CONTENTION ANOMALY: Job " << i << "\n";
-                    static std::mutex contention_mutex;
-                    std::lock_guard<std::mutex> lock(contention_mutex);
+                    static anomsched::mutex contention_mutex("contention_mutex");
+                    std::lock_guard<anomsched::mutex> lock(contention_mutex);
                     std::this_thread::sleep_for(std::chrono::milliseconds(200));
                     break;
                 }
@@ -76,7 +82,7 @@ void advancedStressTest(Scheduler &scheduler, int jobCount)
                     std::this_thread::sleep_for(std::chrono::milliseconds(sleep_ms));
                     break;
                 }
-            } }, (i % 10) + 1);
+            } }, (i % 10) + 1, job_options);
     }
 }
 
@@ -91,6 +97,17 @@ int main()
     std::this_thread::sleep_for(std::chrono::seconds(15)); // Longer wait
     scheduler.stop();
     std::cout << "Scheduler stopped.\n";
+    anomsched::writeContentionReport(std::cout);
+
+    // How well each real-time detector finds the anomalies injected above
+    std::vector<ExecutionRecord> records;
+    std::string error;
+    if (readExecutionLog("execution_log.csv", records, error))
+        writeDetectorScores(std::cout, records);
+    else
+        std::cerr << "cannot score detectors: " << error << "\n";
+    if (kProbesEnabled)
+        writePhaseReport(std::cout, scheduler.snapshot().phases);
 
     return 0;
 }
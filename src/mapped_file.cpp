@@ -0,0 +1,118 @@
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &filename, std::string &error)
+{
+    close();
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        error = "cannot open " + filename;
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size))
+    {
+        CloseHandle(file);
+        error = "cannot stat " + filename;
+        return false;
+    }
+    file_handle = file;
+    length = (size_t)file_size.QuadPart;
+    if (length == 0)
+        return true;
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        close();
+        error = "cannot map " + filename;
+        return false;
+    }
+    mapping_handle = mapping;
+    bytes = static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!bytes)
+    {
+        close();
+        error = "cannot map " + filename;
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        UnmapViewOfFile(bytes);
+    if (mapping_handle)
+        CloseHandle(mapping_handle);
+    if (file_handle)
+        CloseHandle(file_handle);
+    bytes = nullptr;
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+    length = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string &filename, std::string &error)
+{
+    close();
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "cannot open " + filename;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        error = "cannot stat " + filename;
+        return false;
+    }
+    length = (size_t)st.st_size;
+    if (length > 0)
+    {
+        void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED)
+        {
+            ::close(fd);
+            length = 0;
+            error = "cannot map " + filename;
+            return false;
+        }
+        // Logs are scanned front to back; let the kernel read ahead aggressively
+        madvise(mapped, length, MADV_SEQUENTIAL);
+        bytes = static_cast<const unsigned char *>(mapped);
+    }
+    ::close(fd); // the mapping keeps the file alive
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        munmap(const_cast<unsigned char *>(bytes), length);
+    bytes = nullptr;
+    length = 0;
+}
+
+#endif
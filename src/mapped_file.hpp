@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// ------------------- Read-only Memory Map ---------------------
+// Maps a whole file read-only so analysis tools can scan multi-GB logs
+// without copying them into the heap.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Returns false (with a message in error) if the file can't be mapped
+    bool open(const std::string &filename, std::string &error);
+    void close();
+
+    const unsigned char *data() const { return bytes; }
+    size_t size() const { return length; }
+
+private:
+    const unsigned char *bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void *file_handle = nullptr;
+    void *mapping_handle = nullptr;
+#endif
+};
@@ -0,0 +1,244 @@
+#include "metrics_exporter.hpp"
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // Prometheus-style bucket bounds for job latencies, in seconds
+    const double kBucketBounds[] = {1e-5, 5e-5, 1e-4, 5e-4, 1e-3, 5e-3, 1e-2, 5e-2, 0.1, 0.5, 1.0, 5.0, 10.0};
+
+    void writeHistogram(std::ostream &out, const char *name, const char *help, const HistogramSnapshot &h)
+    {
+        out << "# TYPE " << name << " histogram\n";
+        out << "# UNIT " << name << " seconds\n";
+        out << "# HELP " << name << " " << help << "\n";
+        for (double bound : kBucketBounds)
+        {
+            out << name << "_bucket{le=\"" << bound << "\"} "
+                << h.countAtOrBelow((uint64_t)(bound * 1e9)) << "\n";
+        }
+        out << name << "_bucket{le=\"+Inf\"} " << h.count << "\n";
+        out << name << "_count " << h.count << "\n";
+        out << name << "_sum " << h.sum_ns / 1e9 << "\n";
+    }
+
+    void writeGauge(std::ostream &out, const char *name, const char *help)
+    {
+        out << "# TYPE " << name << " gauge\n";
+        out << "# HELP " << name << " " << help << "\n";
+    }
+
+    void writeCounter(std::ostream &out, const char *name, const char *help)
+    {
+        out << "# TYPE " << name << " counter\n";
+        out << "# HELP " << name << " " << help << "\n";
+    }
+}
+
+std::string renderOpenMetrics(const SchedulerSnapshot &snap, double jobs_per_sec)
+{
+    std::ostringstream out;
+
+    writeGauge(out, "anomsched_queue_depth", "Jobs waiting in the shared and per-worker queues.");
+    out << "anomsched_queue_depth " << snap.queued_jobs << "\n";
+
+    writeGauge(out, "anomsched_workers", "Worker threads by state.");
+    out << "anomsched_workers{state=\"busy\"} " << snap.busy_workers << "\n";
+    out << "anomsched_workers{state=\"idle\"} " << (snap.worker_count - snap.busy_workers) << "\n";
+
+    writeGauge(out, "anomsched_jobs_per_second", "Completed jobs per second since the previous refresh.");
+    out << "anomsched_jobs_per_second " << jobs_per_sec << "\n";
+
+    writeCounter(out, "anomsched_jobs", "Completed jobs.");
+    out << "anomsched_jobs_total " << snap.exec_histogram.count << "\n";
+
+    writeCounter(out, "anomsched_worker_jobs", "Completed jobs by worker; -1 = submitting threads.");
+    for (const WorkerLatency &w : snap.workers)
+        out << "anomsched_worker_jobs_total{worker=\"" << w.worker << "\"} " << w.exec.count << "\n";
+
+    writeCounter(out, "anomsched_admissions", "submitJob() outcomes.");
+    out << "anomsched_admissions_total{result=\"accepted\"} " << snap.admission.accepted << "\n";
+    out << "anomsched_admissions_total{result=\"rejected\"} " << snap.admission.rejected << "\n";
+    out << "anomsched_admissions_total{result=\"shed\"} " << snap.admission.shed << "\n";
+    out << "anomsched_admissions_total{result=\"caller_runs\"} " << snap.admission.caller_runs << "\n";
+    out << "anomsched_admissions_total{result=\"inline\"} " << snap.admission.inline_runs << "\n";
+
+    writeCounter(out, "anomsched_anomalies", "Jobs flagged by the real-time anomaly detector.");
+    out << "anomsched_anomalies_total " << snap.log.anomalies << "\n";
+
+    writeCounter(out, "anomsched_anomaly_kinds", "Flagged jobs by cause, when resource counters are logged.");
+    for (AnomalyKind kind : {AnomalyKind::Compute, AnomalyKind::Memory, AnomalyKind::Blocked, AnomalyKind::Contention})
+        out << "anomsched_anomaly_kinds_total{kind=\"" << anomalyKindName(kind) << "\"} "
+            << snap.log.anomaly_kinds[(int)kind] << "\n";
+
+    writeCounter(out, "anomsched_log_records", "Execution records seen and persisted by the logger.");
+    out << "anomsched_log_records_total{state=\"seen\"} " << snap.log.seen << "\n";
+    out << "anomsched_log_records_total{state=\"persisted\"} " << snap.log.persisted << "\n";
+
+    writeHistogram(out, "anomsched_job_exec_seconds", "Job execution time.", snap.exec_histogram);
+    writeHistogram(out, "anomsched_job_queue_wait_seconds", "Time from submit to start.", snap.wait_histogram);
+
+    out << "# EOF\n";
+    return out.str();
+}
+
+MetricsExporter::MetricsExporter(const Scheduler &scheduler_, const MetricsExporterOptions &options_)
+    : scheduler(scheduler_), options(options_)
+{
+}
+
+MetricsExporter::~MetricsExporter()
+{
+    stop();
+}
+
+#ifdef _WIN32
+
+bool MetricsExporter::start(std::string &error)
+{
+    error = "the metrics exporter needs POSIX sockets";
+    return false;
+}
+
+void MetricsExporter::stop() {}
+void MetricsExporter::serveLoop() {}
+void MetricsExporter::serveClient(int) {}
+
+#else
+
+bool MetricsExporter::start(std::string &error)
+{
+    if (server.joinable())
+        return true;
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.bind_address.c_str(), &addr.sin_addr) != 1)
+    {
+        error = "invalid bind address " + options.bind_address;
+        return false;
+    }
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+    {
+        error = std::string("socket: ") + std::strerror(errno);
+        return false;
+    }
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(listen_fd, 16) != 0)
+    {
+        error = "cannot listen on " + options.bind_address + ":" + std::to_string(options.port) + ": " +
+                std::strerror(errno);
+        ::close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd, reinterpret_cast<sockaddr *>(&addr), &len);
+    bound_port = ntohs(addr.sin_port);
+
+    refresh();
+    stopping = false;
+    server = std::thread(&MetricsExporter::serveLoop, this);
+    return true;
+}
+
+void MetricsExporter::stop()
+{
+    if (!server.joinable())
+        return;
+    stopping = true;
+    server.join();
+    ::close(listen_fd);
+    listen_fd = -1;
+}
+
+void MetricsExporter::serveLoop()
+{
+    const int kPollMs = 100; // bounds how long stop() waits
+    while (!stopping)
+    {
+        pollfd pfd = {listen_fd, POLLIN, 0};
+        int ready = poll(&pfd, 1, kPollMs);
+
+        if (std::chrono::steady_clock::now() - last_refresh >= std::chrono::milliseconds(options.refresh_ms))
+            refresh();
+
+        if (ready > 0 && (pfd.revents & POLLIN))
+        {
+            int client = accept(listen_fd, nullptr, nullptr);
+            if (client >= 0)
+            {
+                serveClient(client);
+                ::close(client);
+            }
+        }
+    }
+}
+
+void MetricsExporter::serveClient(int client)
+{
+    // A stalled client must not hold up refreshes for long
+    timeval timeout = {1, 0};
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192)
+    {
+        ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+        if (n <= 0)
+            return;
+        request.append(buffer, (size_t)n);
+    }
+
+    bool metrics = request.compare(0, 13, "GET /metrics ") == 0 || request.compare(0, 6, "GET / ") == 0;
+    const std::string &body = metrics ? page : std::string("not found\n");
+    std::string response = std::string(metrics ? "HTTP/1.1 200 OK\r\n" : "HTTP/1.1 404 Not Found\r\n") +
+                           (metrics ? "Content-Type: application/openmetrics-text; version=1.0.0; charset=utf-8\r\n"
+                                    : "Content-Type: text/plain\r\n") +
+                           "Content-Length: " + std::to_string(body.size()) + "\r\n" +
+                           "Connection: close\r\n\r\n" + body;
+
+    size_t sent = 0;
+    while (sent < response.size())
+    {
+        ssize_t n = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+            return;
+        sent += (size_t)n;
+    }
+}
+
+#endif
+
+void MetricsExporter::refresh()
+{
+    SchedulerSnapshot snap = scheduler.snapshot();
+    auto now = std::chrono::steady_clock::now();
+    double jobs_per_sec = 0.0;
+    if (last_refresh.time_since_epoch().count() != 0)
+    {
+        double seconds = std::chrono::duration<double>(now - last_refresh).count();
+        if (seconds > 0)
+            jobs_per_sec = double(snap.exec_histogram.count - last_completed) / seconds;
+    }
+    last_completed = snap.exec_histogram.count;
+    last_refresh = now;
+    page = renderOpenMetrics(snap, jobs_per_sec);
+}
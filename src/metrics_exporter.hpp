@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include "scheduler.hpp"
+
+// ------------------- Metrics Exporter ---------------------
+// Minimal HTTP server that answers GET /metrics with the scheduler's
+// state in OpenMetrics text format, for Prometheus or curl.
+//
+// A single background thread refreshes a pre-rendered page every
+// refresh_ms from Scheduler::snapshot() and serves scrapes from it, so a
+// scrape costs the scheduler nothing and never touches queue_mutex.
+// Only one connection is served at a time. POSIX sockets only; start()
+// fails on Windows.
+
+struct MetricsExporterOptions
+{
+    std::string bind_address = "127.0.0.1";
+    uint16_t port = 9464; // 0 = any free port, see MetricsExporter::port()
+    int refresh_ms = 1000;
+};
+
+// OpenMetrics exposition of one snapshot; jobs_per_sec comes from the caller
+std::string renderOpenMetrics(const SchedulerSnapshot &snap, double jobs_per_sec);
+
+class MetricsExporter
+{
+public:
+    MetricsExporter(const Scheduler &scheduler, const MetricsExporterOptions &options = MetricsExporterOptions());
+    ~MetricsExporter();
+
+    bool start(std::string &error);
+    void stop();
+
+    uint16_t port() const { return bound_port; }
+
+private:
+    void serveLoop();
+    void refresh();
+    void serveClient(int client);
+
+    const Scheduler &scheduler;
+    MetricsExporterOptions options;
+    int listen_fd = -1;
+    uint16_t bound_port = 0;
+    std::thread server;
+    std::atomic<bool> stopping{false};
+
+    std::string page; // only touched by the server thread
+    uint64_t last_completed = 0;
+    std::chrono::steady_clock::time_point last_refresh;
+};
@@ -0,0 +1,134 @@
+#include "perf_counters.hpp"
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+PerfCounters::~PerfCounters()
+{
+    close();
+}
+
+#ifdef __linux__
+
+namespace
+{
+    struct EventSpec
+    {
+        uint32_t type;
+        uint64_t config;
+    };
+
+    const EventSpec kEvents[kPerfCounterCount] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    };
+}
+
+bool PerfCounters::open(std::string &error)
+{
+    close();
+    std::string first_error;
+    for (int i = 0; i < kPerfCounterCount; ++i)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = kEvents[i].type;
+        attr.config = kEvents[i].config;
+        attr.read_format = PERF_FORMAT_GROUP;
+        // Unprivileged users may only count user space in hardware events;
+        // context switches happen in the kernel, so software events keep it
+        attr.exclude_kernel = kEvents[i].type == PERF_TYPE_HARDWARE;
+        attr.exclude_hv = 1;
+
+        int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+        if (fd < 0)
+        {
+            if (first_error.empty())
+                first_error = std::strerror(errno);
+            continue;
+        }
+        if (leader < 0)
+            leader = fd;
+        fds[i] = fd;
+        order[opened++] = i;
+        valid_mask |= 1u << i;
+    }
+    if (opened == 0)
+    {
+        error = "perf_event_open: " + first_error;
+        return false;
+    }
+    return true;
+}
+
+void PerfCounters::close()
+{
+    for (int &fd : fds)
+    {
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+    }
+    leader = -1;
+    opened = 0;
+    valid_mask = 0;
+}
+
+bool PerfCounters::read(uint64_t (&values)[kPerfCounterCount])
+{
+    // PERF_FORMAT_GROUP: { u64 nr; u64 value[nr]; } in open order
+    uint64_t buffer[1 + kPerfCounterCount];
+    if (leader < 0 || ::read(leader, buffer, sizeof(uint64_t) * (1 + opened)) <= 0)
+        return false;
+    for (int i = 0; i < kPerfCounterCount; ++i)
+        values[i] = 0;
+    for (int k = 0; k < opened && k < (int)buffer[0]; ++k)
+        values[order[k]] = buffer[1 + k];
+    return true;
+}
+
+bool readThreadCpuUsage(ThreadCpuUsage &usage)
+{
+    timespec ts;
+    rusage ru;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0 || getrusage(RUSAGE_THREAD, &ru) != 0)
+        return false;
+    usage.cpu_ns = int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    usage.voluntary_switches = (uint64_t)ru.ru_nvcsw;
+    usage.involuntary_switches = (uint64_t)ru.ru_nivcsw;
+    return true;
+}
+
+#else
+
+bool PerfCounters::open(std::string &error)
+{
+    error = "perf counters need Linux perf_event_open";
+    return false;
+}
+
+void PerfCounters::close() {}
+
+bool PerfCounters::read(uint64_t (&)[kPerfCounterCount])
+{
+    return false;
+}
+
+bool readThreadCpuUsage(ThreadCpuUsage &)
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "log_format.hpp"
+
+// ------------------- Perf Counters ---------------------
+// Per-thread perf_event_open counters (cycles, instructions, LLC misses,
+// context switches, page faults, task clock) read as one group, so a sample is a
+// single read() syscall. Counters the kernel or VM refuses (hardware
+// counters under most hypervisors, or perf_event_paranoid > 2) are
+// skipped; valid() says which ones are live. Linux only: elsewhere open()
+// fails and the scheduler logs jobs without the perf group.
+//
+// open() counts the calling thread, so each worker opens its own.
+class PerfCounters
+{
+public:
+    PerfCounters() = default;
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+    ~PerfCounters();
+
+    // False (with a reason) if no counter at all could be opened
+    bool open(std::string &error);
+    void close();
+
+    uint32_t valid() const { return valid_mask; } // bit i = PerfCounter i
+
+    // Running totals since open(), indexed by PerfCounter
+    bool read(uint64_t (&values)[kPerfCounterCount]);
+
+private:
+    int leader = -1;
+    int fds[kPerfCounterCount] = {-1, -1, -1, -1, -1, -1};
+    int order[kPerfCounterCount] = {}; // group read position -> PerfCounter
+    int opened = 0;
+    uint32_t valid_mask = 0;
+};
+
+// ------------------- Thread CPU Usage ---------------------
+// CPU time (CLOCK_THREAD_CPUTIME_ID) and context switches (getrusage
+// RUSAGE_THREAD) of the calling thread. Unlike PerfCounters this needs no
+// permissions, but costs two syscalls per sample. Linux only: elsewhere
+// read fails and jobs are logged without the CPU group.
+struct ThreadCpuUsage
+{
+    int64_t cpu_ns = 0;
+    uint64_t voluntary_switches = 0;
+    uint64_t involuntary_switches = 0;
+};
+
+bool readThreadCpuUsage(ThreadCpuUsage &usage);
@@ -0,0 +1,62 @@
+#include "probes.hpp"
+#include <cstdio>
+
+const char *probePhaseName(ProbePhase phase)
+{
+    switch (phase)
+    {
+    case ProbePhase::EnqueueLock:
+        return "enqueue_lock";
+    case ProbePhase::WakeToRun:
+        return "wake_to_run";
+    case ProbePhase::Dequeue:
+        return "dequeue";
+    case ProbePhase::Task:
+        return "task";
+    case ProbePhase::Log:
+        return "log";
+    default:
+        return "";
+    }
+}
+
+PhaseProbes::PhaseProbes()
+{
+    if (kProbesEnabled)
+    {
+        for (int i = 0; i < kProbePhaseCount; ++i)
+            histograms.push_back(std::make_unique<LatencyHistogram>());
+    }
+}
+
+std::vector<PhaseLatency> PhaseProbes::snapshot() const
+{
+    std::vector<PhaseLatency> phases;
+    for (size_t i = 0; i < histograms.size(); ++i)
+    {
+        HistogramSnapshot snap = histograms[i]->snapshot();
+        if (snap.count > 0)
+            phases.push_back({(ProbePhase)i, snap.stats()});
+    }
+    return phases;
+}
+
+void writePhaseReport(std::ostream &out, const std::vector<PhaseLatency> &phases)
+{
+    if (phases.empty())
+    {
+        out << "Scheduler phase probes: not compiled in (configure with -DANOMSCHED_PROBES=ON)\n";
+        return;
+    }
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-14s %10s %12s %12s %12s %12s %12s\n",
+                  "phase", "count", "mean us", "p50 us", "p99 us", "p999 us", "max us");
+    out << line;
+    for (const PhaseLatency &p : phases)
+    {
+        std::snprintf(line, sizeof(line), "%-14s %10llu %12.2f %12.2f %12.2f %12.2f %12.2f\n",
+                      probePhaseName(p.phase), (unsigned long long)p.latency.count, p.latency.mean_us,
+                      p.latency.p50_us, p.latency.p99_us, p.latency.p999_us, p.latency.max_us);
+        out << line;
+    }
+}
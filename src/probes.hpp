@@ -0,0 +1,69 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+#include "latency_histogram.hpp"
+
+// ------------------- Overhead Probes ---------------------
+// Timestamps around each phase a job passes through inside the scheduler,
+// so QueueWaitMS can be split into real queueing and scheduler overhead.
+// Compiled in with -DANOMSCHED_PROBES=ON; otherwise probeNow() and
+// record() are empty constexpr-guarded inlines and cost nothing.
+#ifndef ANOMSCHED_PROBES
+#define ANOMSCHED_PROBES 0
+#endif
+
+constexpr bool kProbesEnabled = ANOMSCHED_PROBES != 0;
+
+enum class ProbePhase
+{
+    EnqueueLock, // submitJob waiting for queue_mutex
+    WakeToRun,   // condvar notify until the woken worker holds the lock
+    Dequeue,     // picking and popping the next job under the lock
+    Task,        // the job's own work
+    Log,         // Logger::log for the finished job
+    Count
+};
+
+constexpr int kProbePhaseCount = (int)ProbePhase::Count;
+
+const char *probePhaseName(ProbePhase phase);
+
+struct PhaseLatency
+{
+    ProbePhase phase = ProbePhase::Task;
+    LatencyStats latency;
+};
+
+// steady_clock nanoseconds, or 0 when probes are compiled out
+inline int64_t probeNow()
+{
+    if constexpr (kProbesEnabled)
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    else
+        return 0;
+}
+
+class PhaseProbes
+{
+public:
+    PhaseProbes();
+
+    void record(ProbePhase phase, int64_t ns)
+    {
+        if constexpr (kProbesEnabled)
+            histograms[(int)phase]->record(ns);
+    }
+
+    // Phases that were hit at least once; empty when compiled out
+    std::vector<PhaseLatency> snapshot() const;
+
+private:
+    std::vector<std::unique_ptr<LatencyHistogram>> histograms; // [ProbePhase]
+};
+
+void writePhaseReport(std::ostream &out, const std::vector<PhaseLatency> &phases);
@@ -1,9 +1,66 @@
 #include "scheduler.hpp"
+#include "alloc_tracker.hpp"
+#include "lock_profiler.hpp"
+#include "metrics_exporter.hpp"
+#include "perf_counters.hpp"
+#include <algorithm>
+#include <iostream>
 
-Scheduler::Scheduler(int num_threads, const std::string &log_filename)
-    : running(false), logger(log_filename)
+namespace
 {
+    // Identifies the worker (if any) running on the current thread
+    thread_local const Scheduler *current_scheduler = nullptr;
+    thread_local int current_worker = -1;
+    thread_local int inline_depth = 0;
+    thread_local PerfCounters *current_perf = nullptr; // open counters of this worker, if any
+
+    // Jump consistent hash (Lamping & Veach): maps a key onto [0, buckets)
+    int jumpConsistentHash(uint64_t key, int buckets)
+    {
+        int64_t b = -1, j = 0;
+        while (j < buckets)
+        {
+            b = j;
+            key = key * 2862933555777941757ULL + 1;
+            j = (int64_t)((b + 1) * (double(1LL << 31) / double((key >> 33) + 1)));
+        }
+        return (int)b;
+    }
+
+    // Optional record groups the options ask the logger to make room for
+    uint32_t recordGroups(const SchedulerOptions &options)
+    {
+        return (options.perf_counters ? kGroupPerf : 0u) | (options.cpu_accounting ? kGroupCpu : 0u) |
+               (options.alloc_tracking && allocTrackingSupported() ? kGroupAlloc : 0u) |
+               (options.lock_profiling ? kGroupLock : 0u);
+    }
+}
+
+Scheduler::Scheduler(int num_threads, const std::string &log_filename,
+                     const SchedulerOptions &options_)
+    : running(false), options(options_),
+      logger(log_filename, options_.log_format, num_threads, options_.log_rotation, options_.log_sampling,
+             recordGroups(options_))
+{
+    if (options.anomaly_detector)
+        logger.setDetector(options.anomaly_detector());
+    logger.setPrintAnomalies(options.print_anomalies);
     workers.reserve(num_threads);
+    for (int i = 0; i < num_threads; ++i)
+        slots.push_back(std::make_unique<WorkerSlot>());
+    for (int i = 0; i <= num_threads; ++i)
+        worker_latency.push_back(std::make_unique<SlotLatency>());
+
+    if (!options.shm_metrics_name.empty())
+    {
+        shm_metrics = std::make_unique<shm::Publisher>();
+        std::string error;
+        if (!shm_metrics->create(options.shm_metrics_name, num_threads, shm::kDefaultRingCapacity, error))
+        {
+            std::cerr << "shared-memory metrics disabled: " << error << "\n";
+            shm_metrics.reset();
+        }
+    }
 }
 
 Scheduler::~Scheduler()
@@ -15,16 +72,41 @@ void Scheduler::start()
 {
     running = true;
     int thread_id = 0;
-    for (; thread_id < (int)workers.capacity(); ++thread_id)
+    for (; thread_id < (int)slots.size(); ++thread_id)
     {
         workers.emplace_back(&Scheduler::worker_loop, this, thread_id);
     }
+
+    if (options.metrics_port > 0 && !exporter)
+    {
+        MetricsExporterOptions metrics;
+        metrics.port = options.metrics_port;
+        metrics.bind_address = options.metrics_bind_address;
+        exporter = std::make_unique<MetricsExporter>(*this, metrics);
+        std::string error;
+        if (!exporter->start(error))
+        {
+            std::cerr << "metrics exporter disabled: " << error << "\n";
+            exporter.reset();
+        }
+    }
 }
 
 void Scheduler::stop()
 {
-    running = false;
-    condition.notify_all();
+    if (exporter)
+    {
+        exporter->stop();
+        exporter.reset();
+    }
+    {
+        // Flip under the lock so blocked producers and workers can't miss it
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        running = false;
+        for (auto &slot : slots)
+            slot->wake.notify_all();
+    }
+    not_full.notify_all();
     for (auto &t : workers)
     {
         if (t.joinable())
@@ -33,45 +115,484 @@ void Scheduler::stop()
     workers.clear();
 }
 
-void Scheduler::submitJob(std::function<void()> task, int priority)
+bool Scheduler::submitJob(std::function<void()> task, int priority,
+                          const JobOptions &job_options, uint64_t *job_id)
+{
+    return enqueue(makeJob(std::move(task), priority, job_id), job_options, true);
+}
+
+bool Scheduler::trySubmitJob(std::function<void()> task, int priority,
+                             const JobOptions &job_options, uint64_t *job_id)
+{
+    return enqueue(makeJob(std::move(task), priority, job_id), job_options, false);
+}
+
+// The one place submitted jobs are built, stamped with their submit time
+Job Scheduler::makeJob(std::function<void()> task, int priority, uint64_t *job_id)
+{
+    Job job(job_ids.next(), priority, std::move(task));
+    if (job_id)
+        *job_id = job.id;
+    return job;
+}
+
+AdmissionStats Scheduler::admissionStats() const
 {
-    Job job;
-    job.id = ++job_counter;  // Add this line
-    job.priority = priority; // Use the provided priority
-    job.task = std::move(task);
-    job.submit_time = std::chrono::high_resolution_clock::now();
+    AdmissionStats stats;
+    stats.accepted = accepted_count.load();
+    stats.rejected = rejected_count.load();
+    stats.shed = shed_count.load();
+    stats.caller_runs = caller_runs_count.load();
+    stats.inline_runs = inline_runs_count.load();
+    return stats;
+}
 
+bool Scheduler::tryRunInline(Job &job, const JobOptions &job_options)
+{
+    bool on_worker = current_scheduler == this;
+    if (inline_depth >= options.max_inline_depth)
+        return false;
+    if (!job_options.tiny &&
+        !(on_worker && options.inline_queue_threshold > 0 &&
+          slots[current_worker]->local_depth.load(std::memory_order_relaxed) +
+                  shared_depth.load(std::memory_order_relaxed) <=
+              options.inline_queue_threshold))
+        return false;
+
+    count(accepted_count, &shm::ShmHeader::accepted);
+    ++inline_runs_count;
+    ++inline_depth;
+    runJob(job, on_worker ? current_worker : -1);
+    --inline_depth;
+    return true;
+}
+
+bool Scheduler::enqueue(Job job, const JobOptions &job_options, bool may_block)
+{
+    job.job_class = job_options.job_class;
+    if (job_options.intended_time)
+        job.submit_time = *job_options.intended_time;
+
+    // Load shedding happens before touching the queue lock. The average
+    // only moves when jobs complete, so an empty queue decays it; otherwise
+    // shedding everything would keep it above the threshold for good.
+    if (options.shed_queue_wait_ms > 0 && job.priority < options.shed_min_priority &&
+        queued_jobs.load(std::memory_order_relaxed) == 0)
+        logger.noteEmptyQueue();
+    if (options.shed_queue_wait_ms > 0 && job.priority < options.shed_min_priority &&
+        logger.recentQueueWaitMS() > options.shed_queue_wait_ms)
     {
-        std::lock_guard<std::mutex> lock(queue_mutex);
-        job_queue.push(job);
+        count(shed_count, &shm::ShmHeader::shed);
+        return false;
+    }
+
+    // Skip the enqueue/wake/dequeue round trip when it would cost more than the job
+    if (tryRunInline(job, job_options))
+        return true;
+
+    const size_t capacity = options.queue_capacity;
+    bool run_on_caller = false;
+    {
+        int64_t lock_requested = probeNow();
+        std::unique_lock<std::mutex> lock(queue_mutex);
+        probes.record(ProbePhase::EnqueueLock, probeNow() - lock_requested);
+        if (capacity > 0 && queued_jobs >= capacity)
+        {
+            if (options.overflow_policy == OverflowPolicy::Block && may_block && current_scheduler == this)
+            {
+                // Only other workers could free a slot for a waiting worker,
+                // and they may all be waiting too (fan-out under load). Run
+                // the job here instead, or once that has nested
+                // max_inline_depth deep, queue it past capacity.
+                run_on_caller = inline_depth < options.max_inline_depth;
+            }
+            else if (options.overflow_policy == OverflowPolicy::Block && may_block)
+            {
+                // Before start() nothing would ever drain the queue
+                not_full.wait(lock, [this, capacity]
+                              { return queued_jobs < capacity || !running; });
+                if (queued_jobs >= capacity)
+                {
+                    count(rejected_count, &shm::ShmHeader::rejected);
+                    return false;
+                }
+            }
+            else if (options.overflow_policy == OverflowPolicy::ShedLowestPriority &&
+                     lowestPriorityQueue()->lowestPriority() < job.priority)
+            {
+                JobQueue *lowest = lowestPriorityQueue();
+                lowest->evictLowest();
+                queueResized(lowest);
+                --queued_jobs;
+                publishQueued();
+                count(shed_count, &shm::ShmHeader::shed);
+            }
+            else if (options.overflow_policy == OverflowPolicy::CallerRuns && may_block)
+            {
+                run_on_caller = true;
+            }
+            else
+            {
+                if (options.overflow_policy == OverflowPolicy::ShedLowestPriority)
+                    count(shed_count, &shm::ShmHeader::shed);
+                else
+                    count(rejected_count, &shm::ShmHeader::rejected);
+                return false;
+            }
+        }
+
+        // Affinity only routes queued jobs. Like inline runs, a caller-run
+        // job keeps preferred_worker = -1 and logs AffinityHit -1.
+        if (!run_on_caller)
+        {
+            if (job_options.affinity_key)
+            {
+                job.affinity_key = job_options.affinity_key;
+                job.preferred_worker = preferredWorker(*job_options.affinity_key);
+            }
+            int preferred = job.preferred_worker;
+            JobQueue &target = preferred >= 0 ? slots[preferred]->local : job_queue;
+            target.push(std::move(job));
+            queueResized(&target);
+            ++queued_jobs;
+            publishQueued();
+            wakeWorker(preferred);
+        }
     }
-    condition.notify_one();
+
+    count(accepted_count, &shm::ShmHeader::accepted);
+    if (run_on_caller)
+    {
+        ++caller_runs_count;
+        ++inline_depth; // bounds jobs that keep submitting into a full queue
+        runJob(job, -1); // ThreadID -1 marks jobs run by a submitting thread
+        --inline_depth;
+    }
+    return true;
+}
+
+int Scheduler::preferredWorker(uint64_t key) const
+{
+    auto it = affinity_owner.find(key);
+    if (it != affinity_owner.end())
+        return it->second;
+    return jumpConsistentHash(key, (int)slots.size());
+}
+
+Job Scheduler::takeJob(int thread_id)
+{
+    // Own affinity queue first unless the shared queue has something more
+    // urgent, then the shared queue, then steal from the busiest-looking peer
+    JobQueue &local = slots[thread_id]->local;
+    JobQueue *source = nullptr;
+    if (!local.empty() && (job_queue.empty() || local.top().priority >= job_queue.top().priority))
+        source = &local;
+    else if (!job_queue.empty())
+        source = &job_queue;
+    else
+    {
+        for (auto &slot : slots)
+        {
+            if (!slot->local.empty() &&
+                (!source || slot->local.top().priority > source->top().priority))
+                source = &slot->local;
+        }
+    }
+
+    Job job = source->pop();
+    queueResized(source);
+    --queued_jobs;
+    publishQueued();
+
+    if (job.affinity_key)
+    {
+        if (affinity_owner.size() >= options.max_affinity_keys)
+            affinity_owner.clear();
+        affinity_owner[*job.affinity_key] = thread_id;
+    }
+    return job;
+}
+
+// Admission counters are mirrored into the shared-memory header as they
+// change, so anomsched-top stays current while every worker is busy
+void Scheduler::count(std::atomic<uint64_t> &counter, shm::Counter shm::ShmHeader::*shared)
+{
+    ++counter;
+    if (shm_metrics)
+        (shm_metrics->header()->*shared).fetch_add(1, std::memory_order_relaxed);
+}
+
+// Under queue_mutex, so the stores land in the order of the changes
+void Scheduler::publishQueued()
+{
+    if (shm_metrics)
+        shm_metrics->header()->queued_jobs.store(queued_jobs.load(std::memory_order_relaxed),
+                                                 std::memory_order_relaxed);
+}
+
+// Publishes a queue's new size to its lock-free readers; under queue_mutex
+void Scheduler::queueResized(JobQueue *queue)
+{
+    if (queue == &job_queue)
+    {
+        shared_depth.store(job_queue.size(), std::memory_order_relaxed);
+        return;
+    }
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        if (&slots[i]->local != queue)
+            continue;
+        slots[i]->local_depth.store(queue->size(), std::memory_order_relaxed);
+        if (shm_metrics)
+            shm_metrics->setLocalDepth((int)i, queue->size());
+        return;
+    }
+}
+
+void Scheduler::wakeWorker(int preferred)
+{
+    // Prefer the worker the job was routed to; otherwise any idle worker,
+    // which will steal the job if it isn't in the shared queue
+    if (preferred >= 0 && slots[preferred]->idle)
+    {
+        slots[preferred]->idle = false;
+        slots[preferred]->notified_ns = probeNow();
+        slots[preferred]->wake.notify_one();
+        return;
+    }
+    for (auto &slot : slots)
+    {
+        if (slot->idle)
+        {
+            slot->idle = false;
+            slot->notified_ns = probeNow();
+            slot->wake.notify_one();
+            return;
+        }
+    }
+}
+
+JobQueue *Scheduler::lowestPriorityQueue()
+{
+    JobQueue *lowest = job_queue.empty() ? nullptr : &job_queue;
+    for (auto &slot : slots)
+    {
+        if (!slot->local.empty() &&
+            (!lowest || slot->local.lowestPriority() < lowest->lowestPriority()))
+            lowest = &slot->local;
+    }
+    return lowest;
+}
+
+void Scheduler::runJob(Job &job, int thread_id)
+{
+    using std::chrono::duration_cast;
+    using std::chrono::nanoseconds;
+
+    // Counters belong to the worker thread, so only its own jobs can use them
+    PerfCounters *perf = current_scheduler == this ? current_perf : nullptr;
+    uint64_t perf_before[kPerfCounterCount];
+    if (perf && !perf->read(perf_before))
+        perf = nullptr;
+
+    // A job run inline by a worker is nested in that worker's current job,
+    // which stays the one its shared-memory slot shows
+    int shm_worker = inline_depth > 0 ? -1 : thread_id;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    if (shm_metrics && shm_worker >= 0)
+        shm_metrics->jobStarted(shm_worker, job.id, duration_cast<nanoseconds>(start_time.time_since_epoch()).count());
+    // Sampled inside the wall-clock window so CPU time never exceeds it
+    ThreadCpuUsage cpu_before, cpu_after;
+    bool cpu = options.cpu_accounting && readThreadCpuUsage(cpu_before);
+    AllocScope alloc_scope;
+    bool alloc = options.alloc_tracking && allocTrackingSupported();
+    if (alloc)
+        alloc_scope.begin();
+    // Always scoped, so contention reports name the jobs even when waits aren't logged
+    anomsched::LockWaitScope lock_scope;
+    lock_scope.begin(job.id);
+    job.task();
+    anomsched::LockWaitStats lock_stats = lock_scope.end();
+    AllocStats alloc_stats;
+    if (alloc)
+        alloc_stats = alloc_scope.end();
+    cpu = cpu && readThreadCpuUsage(cpu_after);
+    auto end_time = std::chrono::high_resolution_clock::now();
+    uint64_t perf_after[kPerfCounterCount];
+    if (perf && !perf->read(perf_after))
+        perf = nullptr;
+
+    ExecutionRecord record;
+    record.job_id = job.id;
+    record.thread_id = thread_id;
+    record.priority = job.priority;
+    record.preferred_thread = job.preferred_worker;
+    record.job_class = job.job_class;
+    if (perf)
+    {
+        record.groups |= kGroupPerf;
+        record.perf_valid = perf->valid();
+        for (int i = 0; i < kPerfCounterCount; ++i)
+            record.perf[i] = perf_after[i] - perf_before[i];
+    }
+    record.submit_ns = duration_cast<nanoseconds>(job.submit_time.time_since_epoch()).count();
+    record.start_ns = duration_cast<nanoseconds>(start_time.time_since_epoch()).count();
+    record.end_ns = duration_cast<nanoseconds>(end_time.time_since_epoch()).count();
+    if (cpu)
+    {
+        int64_t wall_ns = record.end_ns - record.start_ns;
+        record.groups |= kGroupCpu;
+        record.cpu_ns = cpu_after.cpu_ns - cpu_before.cpu_ns;
+        record.voluntary_switches = uint32_t(cpu_after.voluntary_switches - cpu_before.voluntary_switches);
+        record.involuntary_switches = uint32_t(cpu_after.involuntary_switches - cpu_before.involuntary_switches);
+        record.on_cpu_permille = wall_ns > 0 ? uint32_t(std::min<int64_t>(record.cpu_ns * 1000 / wall_ns, 1000)) : 1000;
+    }
+    if (alloc)
+    {
+        record.groups |= kGroupAlloc;
+        record.alloc_bytes = alloc_stats.bytes;
+        record.allocations = alloc_stats.allocations;
+        record.alloc_peak_bytes = alloc_stats.peak_bytes;
+    }
+    if (options.lock_profiling)
+    {
+        record.groups |= kGroupLock;
+        record.lock_wait_ns = lock_stats.wait_ns;
+        record.lock_waits = lock_stats.waits;
+    }
+
+    int64_t exec_ns = record.end_ns - record.start_ns;
+    int64_t wait_ns = record.start_ns - record.submit_ns;
+    SlotLatency &slot_latency = *worker_latency[thread_id + 1];
+    JobLatency &by_worker = slot_latency.all;
+    JobLatency &by_priority = slot_latency.priority(std::min(std::max(job.priority, 0), kPriorityLevels - 1));
+    by_worker.exec.record(exec_ns);
+    by_worker.wait.record(wait_ns);
+    by_priority.exec.record(exec_ns);
+    by_priority.wait.record(wait_ns);
+
+    probes.record(ProbePhase::Task, exec_ns);
+    int64_t log_start = probeNow();
+    record.is_anomaly = logger.log(record);
+    probes.record(ProbePhase::Log, probeNow() - log_start);
+
+    if (shm_metrics)
+        shm_metrics->jobFinished(shm_worker, record);
+}
+
+SchedulerSnapshot Scheduler::snapshot() const
+{
+    SchedulerSnapshot snap;
+    snap.queued_jobs = queued_jobs.load();
+    snap.worker_count = (int)slots.size();
+    snap.busy_workers = busy_workers.load();
+    snap.admission = admissionStats();
+    snap.log = logger.stats();
+    snap.phases = probes.snapshot();
+
+    HistogramSnapshot all_exec, all_wait;
+    HistogramSnapshot priority_exec[kPriorityLevels], priority_wait[kPriorityLevels];
+    for (size_t i = 0; i < worker_latency.size(); ++i)
+    {
+        const SlotLatency &slot_latency = *worker_latency[i];
+        HistogramSnapshot exec = slot_latency.all.exec.snapshot();
+        if (exec.count == 0)
+            continue;
+        HistogramSnapshot wait = slot_latency.all.wait.snapshot();
+        snap.workers.push_back({(int)i - 1, exec.stats(), wait.stats()});
+        all_exec.merge(exec);
+        all_wait.merge(wait);
+
+        for (int p = 0; p < kPriorityLevels; ++p)
+        {
+            const JobLatency *by_priority = slot_latency.by_priority[p].load(std::memory_order_acquire);
+            if (!by_priority)
+                continue;
+            priority_exec[p].merge(by_priority->exec.snapshot());
+            priority_wait[p].merge(by_priority->wait.snapshot());
+        }
+    }
+    snap.exec = all_exec.stats();
+    snap.wait = all_wait.stats();
+    snap.exec_histogram = std::move(all_exec);
+    snap.wait_histogram = std::move(all_wait);
+
+    for (int p = 0; p < kPriorityLevels; ++p)
+    {
+        if (priority_exec[p].count == 0)
+            continue;
+        snap.priorities.push_back({p, priority_exec[p].stats(), priority_wait[p].stats()});
+    }
+    return snap;
+}
+
+Scheduler::SlotLatency::~SlotLatency()
+{
+    for (auto &latency : by_priority)
+        delete latency.load();
+}
+
+// Slot 0 is shared by all submitting threads, so two may race to allocate
+Scheduler::JobLatency &Scheduler::SlotLatency::priority(int p)
+{
+    JobLatency *latency = by_priority[p].load(std::memory_order_acquire);
+    if (latency)
+        return *latency;
+    JobLatency *fresh = new JobLatency;
+    if (by_priority[p].compare_exchange_strong(latency, fresh, std::memory_order_acq_rel))
+        return *fresh;
+    delete fresh;
+    return *latency;
 }
 
 void Scheduler::worker_loop(int thread_id)
 {
+    current_scheduler = this;
+    current_worker = thread_id;
+
+    PerfCounters perf;
+    if (options.perf_counters)
+    {
+        std::string error;
+        if (perf.open(error))
+            current_perf = &perf;
+        else
+            std::call_once(perf_warning, [&error]
+                           { std::cerr << "perf counters unavailable, logging without them: " << error << "\n"; });
+    }
+
     while (running)
     {
         Job job(0, 0, [] {}); // default empty job
 
         {
             std::unique_lock<std::mutex> lock(queue_mutex);
-            condition.wait(lock, [this]
-                           { return !job_queue.empty() || !running; });
+            WorkerSlot &slot = *slots[thread_id];
+            while (running && queued_jobs == 0)
+            {
+                slot.idle = true;
+                slot.wake.wait(lock);
+            }
+            slot.idle = false;
+            if (slot.notified_ns != 0)
+            {
+                probes.record(ProbePhase::WakeToRun, probeNow() - slot.notified_ns);
+                slot.notified_ns = 0;
+            }
 
-            if (!running && job_queue.empty())
+            if (!running && queued_jobs == 0)
                 return;
 
-            job = job_queue.top();
-            job_queue.pop();
+            int64_t dequeue_start = probeNow();
+            job = takeJob(thread_id);
+            probes.record(ProbePhase::Dequeue, probeNow() - dequeue_start);
         }
 
-        auto start_time = std::chrono::high_resolution_clock::now();
-        auto wait_duration = std::chrono::duration_cast<std::chrono::milliseconds>(start_time - job.submit_time).count();
-        job.task();
-        auto end_time = std::chrono::high_resolution_clock::now();
+        if (options.queue_capacity > 0)
+            not_full.notify_one();
 
-        // Remove the wait_duration parameter - it's calculated inside logger.log()
-        logger.log(job.id, thread_id, job.submit_time, start_time, end_time);
+        ++busy_workers;
+        runJob(job, thread_id);
+        --busy_workers;
     }
 }
@@ -3,58 +3,235 @@
 
 #include <functional>
 #include <vector>
-#include <queue>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include "job.hpp"
+#include "job_queue.hpp"
 #include "logger.hpp"
+#include "latency_histogram.hpp"
+#include "probes.hpp"
+#include "shm_metrics.hpp"
+#include <array>
 
-// ------------------- Job Definition ---------------------
-struct Job
+class MetricsExporter;
+
+// ------------------- Admission Control ---------------------
+// What submitJob() does when the queue is at capacity
+enum class OverflowPolicy
+{
+    Block,              // wait for a worker to free a slot; workers never wait, they run the job themselves
+    Reject,             // fail fast, submitJob() returns false
+    ShedLowestPriority, // evict the lowest-priority queued job if the new one outranks it
+    CallerRuns          // run the job on the submitting thread
+};
+
+struct SchedulerOptions
 {
-    int id;
-    int priority;
-    std::function<void()> task;
-    std::chrono::high_resolution_clock::time_point submit_time;
+    size_t queue_capacity = 0; // 0 = unbounded
+    OverflowPolicy overflow_policy = OverflowPolicy::Block;
 
-    // Default constructor
-    Job() : id(0), priority(0), task([] {}), submit_time(std::chrono::high_resolution_clock::now()) {}
+    // Load shedding: while the logger's smoothed queue wait is above this,
+    // jobs below shed_min_priority are rejected up front. 0 = disabled.
+    double shed_queue_wait_ms = 0.0;
+    int shed_min_priority = 5;
 
-    // Parameterized constructor
-    Job(int id_, int prio, std::function<void()> t)
-        : id(id_), priority(prio), task(std::move(t)), submit_time(std::chrono::high_resolution_clock::now()) {}
+    // Inline fast path: a job submitted from one of this scheduler's own
+    // workers runs directly while the queues that worker takes from (its
+    // affinity queue plus the shared queue) hold at most this many jobs.
+    // Jobs flagged JobOptions::tiny always run inline. 0 = workers never inline.
+    size_t inline_queue_threshold = 0;
+    int max_inline_depth = 8; // bounds recursion of jobs submitting jobs
 
-    // For priority queue comparison (higher priority = run first)
-    bool operator<(const Job &other) const
-    {
-        return priority < other.priority;
-    }
+    // Affinity keys remembered before the key -> worker map is reset
+    size_t max_affinity_keys = 1 << 16;
+
+    LogFormat log_format = LogFormat::Auto; // Auto picks binary for *.bin
+    LogRotation log_rotation;               // size/time-bounded segments, append
+    LogSampling log_sampling;               // which records reach the log file
+
+    // OpenMetrics endpoint at http://<metrics_bind_address>:<metrics_port>/metrics,
+    // started with the workers. 0 = disabled. POSIX only.
+    uint16_t metrics_port = 0;
+    std::string metrics_bind_address = "127.0.0.1";
+
+    // Per-worker perf_event_open counters logged with every job and used to
+    // classify anomalies. Linux only; workers that cannot open any counter
+    // log without them.
+    bool perf_counters = false;
+
+    // Thread CPU time and voluntary/involuntary context switches per job,
+    // logged with an on-CPU ratio that tells blocked from compute-bound
+    // anomalies. Two syscalls per job; Linux only.
+    bool cpu_accounting = false;
+
+    // Heap bytes, allocation count and peak per job, via the global
+    // operator new/delete hooks in alloc_tracker.hpp. Jobs with an unusual
+    // peak are flagged as memory anomalies.
+    bool alloc_tracking = false;
+
+    // Per-job time blocked on anomsched::mutex (lock_profiler.hpp). Jobs
+    // that mostly waited on one are classified as contention anomalies.
+    bool lock_profiling = false;
+
+    // One line per real-time anomaly on std::cout. Tools that print their
+    // own report turn it off.
+    bool print_anomalies = true;
+
+    // Execution-time anomaly detector for the logger, e.g.
+    // [] { return std::make_unique<MedianMadDetector>(); }. Empty = ZScoreDetector.
+    std::function<std::unique_ptr<AnomalyDetector>()> anomaly_detector;
+
+    // POSIX shared memory object (e.g. "/anomsched") for anomsched-top.
+    // Empty = not published.
+    std::string shm_metrics_name;
+};
+
+struct AdmissionStats
+{
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;    // refused because the queue was full
+    uint64_t shed = 0;        // refused or evicted by priority shedding
+    uint64_t caller_runs = 0; // executed on the submitting thread
+    uint64_t inline_runs = 0; // executed inline by the fast path
+};
+
+// ------------------- Latency Snapshot ---------------------
+// Percentiles in microseconds, read from always-on in-memory histograms
+struct WorkerLatency
+{
+    int worker = 0; // -1 = jobs run on submitting threads (caller-runs, inline)
+    LatencyStats exec;
+    LatencyStats wait;
+};
+
+struct PriorityLatency
+{
+    int priority = 0; // priorities are clamped to [0, kPriorityLevels - 1]
+    LatencyStats exec;
+    LatencyStats wait;
+};
+
+struct SchedulerSnapshot
+{
+    size_t queued_jobs = 0;
+    int worker_count = 0;
+    int busy_workers = 0; // workers running a job right now
+    AdmissionStats admission;
+    LogStats log;
+    LatencyStats exec; // all workers merged
+    LatencyStats wait;
+    HistogramSnapshot exec_histogram; // merged buckets behind exec / wait
+    HistogramSnapshot wait_histogram;
+    std::vector<WorkerLatency> workers;      // workers that ran at least one job
+    std::vector<PriorityLatency> priorities; // priorities that ran at least one job
+    std::vector<PhaseLatency> phases;        // scheduler overhead; empty unless built with probes
 };
 
 // ------------------- Scheduler Class ---------------------
 class Scheduler
 {
 public:
-    Scheduler(int num_threads, const std::string &log_filename); // Add log_filename parameter
+    Scheduler(int num_threads, const std::string &log_filename,
+              const SchedulerOptions &options = SchedulerOptions());
     ~Scheduler();
 
     void start();
     void stop();
-    void submitJob(std::function<void()> task, int priority = 0);
+
+    // Returns false if the job was refused by admission control. job_id, if
+    // given, receives the ID the job is logged under (set even if refused).
+    bool submitJob(std::function<void()> task, int priority = 0,
+                   const JobOptions &job_options = JobOptions(), uint64_t *job_id = nullptr);
+
+    // Never blocks: when the queue is full it refuses the job (counted as
+    // rejected under Block and CallerRuns) instead of waiting or running it.
+    // The inline fast path still applies, so tiny jobs run on the caller.
+    bool trySubmitJob(std::function<void()> task, int priority = 0,
+                      const JobOptions &job_options = JobOptions(), uint64_t *job_id = nullptr);
+
+    AdmissionStats admissionStats() const;
+
+    // Latency percentiles so far; cheap enough to poll, never takes queue_mutex
+    SchedulerSnapshot snapshot() const;
+
+    static constexpr int kPriorityLevels = 16;
 
 private:
+    // Per-worker state; every field is guarded by queue_mutex
+    struct WorkerSlot
+    {
+        JobQueue local;                // jobs routed here by affinity
+        std::atomic<size_t> local_depth{0}; // local.size(), also read without the lock
+        std::condition_variable wake;  // each worker sleeps on its own condvar
+        bool idle = false;
+        int64_t notified_ns = 0; // probeNow() of the last wake, 0 once consumed
+    };
+
     void worker_loop(int thread_id); // Match the implementation name
+    Job makeJob(std::function<void()> task, int priority, uint64_t *job_id);
+    // may_block: a full queue may make the caller wait (Block) or run the
+    // job itself (CallerRuns); trySubmitJob() passes false
+    bool enqueue(Job job, const JobOptions &job_options, bool may_block);
+    bool tryRunInline(Job &job, const JobOptions &job_options);
+    void runJob(Job &job, int thread_id);
+
+    int preferredWorker(uint64_t key) const;
+    Job takeJob(int thread_id);
+    void wakeWorker(int preferred);
+    JobQueue *lowestPriorityQueue();
+    void queueResized(JobQueue *queue);
+    void count(std::atomic<uint64_t> &counter, shm::Counter shm::ShmHeader::*shared);
+    void publishQueued();
+
+    struct JobLatency
+    {
+        LatencyHistogram exec;
+        LatencyHistogram wait;
+    };
+
+    // One recording slot's histograms: all its jobs, and per priority so
+    // workers never share cache lines. Priorities get theirs on first use.
+    struct SlotLatency
+    {
+        JobLatency all;
+        std::array<std::atomic<JobLatency *>, kPriorityLevels> by_priority{};
+
+        ~SlotLatency();
+        JobLatency &priority(int p);
+    };
 
     std::vector<std::thread> workers;
-    std::priority_queue<Job> job_queue;
+    std::vector<std::unique_ptr<WorkerSlot>> slots;
+    JobQueue job_queue; // shared queue for jobs without affinity
+    std::unordered_map<uint64_t, int> affinity_owner; // key -> worker that last ran it
     std::mutex queue_mutex;
-    std::condition_variable condition;
+    std::condition_variable not_full; // producers blocked on a full queue
     std::atomic<bool> running;
-    std::atomic<int> job_counter{0}; // Add this line
+    JobIdAllocator job_ids;
+
+    SchedulerOptions options;
+    std::atomic<uint64_t> accepted_count{0};
+    std::atomic<uint64_t> rejected_count{0};
+    std::atomic<uint64_t> shed_count{0};
+    std::atomic<uint64_t> caller_runs_count{0};
+    std::atomic<uint64_t> inline_runs_count{0};
+    std::atomic<size_t> queued_jobs{0}; // jobs in all queues, readable without the lock
+    std::atomic<size_t> shared_depth{0}; // job_queue.size(), readable without the lock
+    std::atomic<int> busy_workers{0};
+    std::once_flag perf_warning; // "perf unavailable" is reported once, not per worker
+
+    std::vector<std::unique_ptr<SlotLatency>> worker_latency; // [thread_id + 1]; [0] = submitting threads
+    PhaseProbes probes;
 
     Logger logger; // Handles logging of execution metrics
+    std::unique_ptr<MetricsExporter> exporter;
+    std::unique_ptr<shm::Publisher> shm_metrics;
 };
 
 #endif // SCHEDULER_HPP
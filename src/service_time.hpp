@@ -0,0 +1,89 @@
+#pragma once
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// ------------------- Service Time Distributions ---------------------
+// Synthetic job service times in microseconds, shared by anomsched-loadgen
+// (spent for real) and the simulator (virtual time). Specs:
+//   const:US  exp:MEAN_US  uniform:MIN_US:MAX_US
+//   lognormal:MEDIAN_US:SIGMA  pareto:MIN_US:ALPHA
+struct ServiceTimeDistribution
+{
+    enum Kind
+    {
+        Constant,
+        Exponential,
+        Uniform,
+        LogNormal,
+        Pareto
+    } kind = Constant;
+    double a = 0, b = 0;
+
+    template <typename Rng>
+    double sample(Rng &rng) const
+    {
+        switch (kind)
+        {
+        case Exponential:
+            return std::exponential_distribution<double>(1.0 / a)(rng);
+        case Uniform:
+            return std::uniform_real_distribution<double>(a, b)(rng);
+        case LogNormal:
+            return std::lognormal_distribution<double>(std::log(a), b)(rng);
+        case Pareto:
+            return a / std::pow(1.0 - std::uniform_real_distribution<double>(0.0, 1.0)(rng), 1.0 / b);
+        default:
+            return a;
+        }
+    }
+
+    double mean() const
+    {
+        switch (kind)
+        {
+        case Uniform:
+            return (a + b) / 2;
+        case LogNormal:
+            return a * std::exp(b * b / 2);
+        case Pareto:
+            return b > 1 ? a * b / (b - 1) : INFINITY;
+        default:
+            return a;
+        }
+    }
+};
+
+// Returns false if spec is not one of the forms above
+inline bool parseServiceTime(const std::string &spec, ServiceTimeDistribution &d)
+{
+    std::vector<std::string> p;
+    size_t begin = 0;
+    while (true)
+    {
+        size_t end = spec.find(':', begin);
+        p.push_back(spec.substr(begin, end - begin));
+        if (end == std::string::npos)
+            break;
+        begin = end + 1;
+    }
+    auto number = [&p](size_t i)
+    { return i < p.size() ? std::atof(p[i].c_str()) : 0.0; };
+
+    using D = ServiceTimeDistribution;
+    if (p[0] == "const" && p.size() == 2)
+        d = {D::Constant, number(1), 0};
+    else if (p[0] == "exp" && p.size() == 2 && number(1) > 0)
+        d = {D::Exponential, number(1), 0};
+    else if (p[0] == "uniform" && p.size() == 3 && number(1) <= number(2))
+        d = {D::Uniform, number(1), number(2)};
+    else if (p[0] == "lognormal" && p.size() == 3 && number(1) > 0)
+        d = {D::LogNormal, number(1), number(2)};
+    else if (p[0] == "pareto" && p.size() == 3 && number(1) > 0 && number(2) > 0)
+        d = {D::Pareto, number(1), number(2)};
+    else
+        return false;
+    return d.a >= 0;
+}
@@ -0,0 +1,311 @@
+#include "shm_metrics.hpp"
+#include <chrono>
+#include <cstring>
+#include <new>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace shm
+{
+    namespace
+    {
+        // Header padded to a cache line, then workers, then the ring
+        constexpr size_t kWorkersOffset = (sizeof(ShmHeader) + 63) / 64 * 64;
+
+        size_t ringOffset(uint32_t worker_count)
+        {
+            return kWorkersOffset + worker_count * sizeof(ShmWorker);
+        }
+
+        size_t layoutSize(uint32_t worker_count, uint32_t ring_capacity)
+        {
+            return ringOffset(worker_count) + ring_capacity * sizeof(ShmRecord);
+        }
+
+        // Seqlock write side; fn stores the protected fields
+        template <typename Fn>
+        void seqWrite(Counter &seq, Fn fn)
+        {
+            uint64_t s = seq.load(std::memory_order_relaxed);
+            seq.store(s + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            fn();
+            seq.store(s + 2, std::memory_order_release);
+        }
+
+        // Seqlock read side; false if the writer kept the slot busy
+        template <typename Fn>
+        bool seqRead(const Counter &seq, Fn fn)
+        {
+            for (int attempt = 0; attempt < 64; ++attempt)
+            {
+                uint64_t before = seq.load(std::memory_order_acquire);
+                if (before & 1)
+                    continue;
+                fn();
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seq.load(std::memory_order_relaxed) == before)
+                    return true;
+            }
+            return false;
+        }
+
+        const auto relaxed = std::memory_order_relaxed;
+    }
+
+    void Publisher::jobStarted(int worker, uint64_t job_id, int64_t start_ns)
+    {
+        ShmWorker &w = workers[worker];
+        seqWrite(w.seq, [&]
+                 {
+                     w.current_job_id.store(job_id, relaxed);
+                     w.current_start_ns.store(start_ns, relaxed); });
+    }
+
+    void Publisher::jobFinished(int worker, const ExecutionRecord &record)
+    {
+        if (worker >= 0)
+        {
+            ShmWorker &w = workers[worker];
+            seqWrite(w.seq, [&]
+                     {
+                         w.jobs.store(w.jobs.load(relaxed) + 1, relaxed);
+                         if (record.is_anomaly)
+                             w.anomalies.store(w.anomalies.load(relaxed) + 1, relaxed);
+                         w.busy_ns.store(w.busy_ns.load(relaxed) + uint64_t(record.end_ns - record.start_ns), relaxed);
+                         w.current_job_id.store(0, relaxed);
+                         w.current_start_ns.store(0, relaxed); });
+        }
+        head->completed.fetch_add(1, relaxed);
+        if (record.is_anomaly)
+            head->anomalies.fetch_add(1, relaxed);
+        pushRecord(record);
+    }
+
+    void Publisher::pushRecord(const ExecutionRecord &record)
+    {
+        // A writer lapped by the whole ring could interleave with this one;
+        // at ring_capacity slots that would take ring_capacity jobs finishing
+        // while one store sequence is in flight
+        uint64_t ticket = head->ring_head.fetch_add(1, relaxed);
+        ShmRecord &slot = ring[ticket % head->ring_capacity];
+        seqWrite(slot.seq, [&]
+                 {
+                     slot.job_id.store(record.job_id, relaxed);
+                     slot.thread_id.store(record.thread_id, relaxed);
+                     slot.priority.store(record.priority, relaxed);
+                     slot.submit_ns.store(record.submit_ns, relaxed);
+                     slot.start_ns.store(record.start_ns, relaxed);
+                     slot.end_ns.store(record.end_ns, relaxed);
+                     slot.is_anomaly.store(record.is_anomaly ? 1 : 0, relaxed); });
+    }
+
+    WorkerView Reader::worker(int index) const
+    {
+        const ShmWorker &w = workers[index];
+        WorkerView view;
+        seqRead(w.seq, [&]
+                {
+                    view.jobs = w.jobs.load(relaxed);
+                    view.anomalies = w.anomalies.load(relaxed);
+                    view.busy_ns = w.busy_ns.load(relaxed);
+                    view.current_job_id = w.current_job_id.load(relaxed);
+                    view.current_start_ns = w.current_start_ns.load(relaxed);
+                    view.local_depth = w.local_depth.load(relaxed); });
+        return view;
+    }
+
+    size_t Reader::recent(ExecutionRecord *out, size_t max) const
+    {
+        uint64_t end = head->ring_head.load(std::memory_order_acquire);
+        uint64_t available = end < head->ring_capacity ? end : head->ring_capacity;
+        size_t n = 0;
+        for (uint64_t i = 0; i < available && n < max; ++i)
+        {
+            const ShmRecord &slot = ring[(end - 1 - i) % head->ring_capacity];
+            ExecutionRecord &r = out[n];
+            bool ok = seqRead(slot.seq, [&]
+                              {
+                                  r.job_id = slot.job_id.load(relaxed);
+                                  r.thread_id = (int32_t)slot.thread_id.load(relaxed);
+                                  r.priority = (int32_t)slot.priority.load(relaxed);
+                                  r.submit_ns = slot.submit_ns.load(relaxed);
+                                  r.start_ns = slot.start_ns.load(relaxed);
+                                  r.end_ns = slot.end_ns.load(relaxed);
+                                  r.is_anomaly = slot.is_anomaly.load(relaxed) != 0; });
+            if (ok && r.job_id != 0)
+                ++n;
+        }
+        return n;
+    }
+
+#ifdef _WIN32
+
+    Publisher::~Publisher() {}
+
+    bool Publisher::create(const std::string &, int, uint32_t, std::string &error)
+    {
+        error = "shared-memory metrics need POSIX shm_open";
+        return false;
+    }
+
+    Reader::~Reader() {}
+
+    bool Reader::open(const std::string &, std::string &error)
+    {
+        error = "shared-memory metrics need POSIX shm_open";
+        return false;
+    }
+
+#else
+
+    namespace
+    {
+        // Whether an existing object's header names a process that is still
+        // running. An object without a complete header counts as stale.
+        bool ownerAlive(const std::string &name, int64_t &pid)
+        {
+            int fd = shm_open(name.c_str(), O_RDONLY, 0);
+            if (fd < 0)
+                return false;
+            struct stat st;
+            void *mapped = MAP_FAILED;
+            if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ShmHeader))
+                mapped = mmap(nullptr, sizeof(ShmHeader), PROT_READ, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (mapped == MAP_FAILED)
+                return false;
+            const ShmHeader *existing = static_cast<const ShmHeader *>(mapped);
+            bool complete = std::memcmp(existing->magic, kMagic, sizeof(kMagic)) == 0;
+            pid = existing->pid;
+            munmap(mapped, sizeof(ShmHeader));
+            return complete && pid > 0 && (kill((pid_t)pid, 0) == 0 || errno == EPERM);
+        }
+    }
+
+    Publisher::~Publisher()
+    {
+        if (!base)
+            return;
+        munmap(base, size);
+        shm_unlink(name.c_str());
+    }
+
+    bool Publisher::create(const std::string &name_, int worker_count, uint32_t ring_capacity, std::string &error)
+    {
+        if (ring_capacity == 0)
+            ring_capacity = kDefaultRingCapacity;
+        name = name_;
+        size = layoutSize((uint32_t)worker_count, ring_capacity);
+
+        // Never take over an object another publisher is using: shrinking it
+        // would SIGBUS that process, and both would write the same seqlocks
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0 && errno == EEXIST)
+        {
+            int64_t owner = 0;
+            if (ownerAlive(name, owner))
+            {
+                error = "shm_open " + name + ": in use by running process " + std::to_string(owner);
+                return false;
+            }
+            // Left behind by a publisher that died without unlinking it
+            shm_unlink(name.c_str());
+            fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        }
+        if (fd < 0)
+        {
+            error = "shm_open " + name + ": " + std::strerror(errno);
+            return false;
+        }
+        if (ftruncate(fd, (off_t)size) != 0)
+        {
+            error = "ftruncate " + name + ": " + std::strerror(errno);
+            ::close(fd);
+            shm_unlink(name.c_str());
+            return false;
+        }
+        base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED)
+        {
+            base = nullptr;
+            error = "mmap " + name + ": " + std::strerror(errno);
+            shm_unlink(name.c_str());
+            return false;
+        }
+
+        // ftruncate zero-fills; construct the atomics in place over it
+        head = new (base) ShmHeader();
+        workers = reinterpret_cast<ShmWorker *>(static_cast<unsigned char *>(base) + kWorkersOffset);
+        ring = reinterpret_cast<ShmRecord *>(static_cast<unsigned char *>(base) + ringOffset((uint32_t)worker_count));
+        for (int i = 0; i < worker_count; ++i)
+            new (&workers[i]) ShmWorker();
+        for (uint32_t i = 0; i < ring_capacity; ++i)
+            new (&ring[i]) ShmRecord();
+
+        head->version = kVersion;
+        head->worker_count = (uint32_t)worker_count;
+        head->ring_capacity = ring_capacity;
+        head->pid = (int64_t)getpid();
+        head->started_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                               std::chrono::high_resolution_clock::now().time_since_epoch())
+                               .count();
+        // Magic last: readers that see it also see a complete layout
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(head->magic, kMagic, sizeof(kMagic));
+        return true;
+    }
+
+    Reader::~Reader()
+    {
+        if (base)
+            munmap(const_cast<void *>(base), size);
+    }
+
+    bool Reader::open(const std::string &name, std::string &error)
+    {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0)
+        {
+            error = "shm_open " + name + ": " + std::strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmHeader))
+        {
+            error = name + " is not an anomsched metrics segment";
+            ::close(fd);
+            return false;
+        }
+        size = (size_t)st.st_size;
+        void *mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            error = "mmap " + name + ": " + std::strerror(errno);
+            return false;
+        }
+        base = mapped;
+        head = static_cast<const ShmHeader *>(base);
+        if (std::memcmp(head->magic, kMagic, sizeof(kMagic)) != 0 || head->version != kVersion ||
+            layoutSize(head->worker_count, head->ring_capacity) > size)
+        {
+            error = name + " is not a compatible anomsched metrics segment";
+            return false;
+        }
+        const unsigned char *bytes = static_cast<const unsigned char *>(base);
+        workers = reinterpret_cast<const ShmWorker *>(bytes + kWorkersOffset);
+        ring = reinterpret_cast<const ShmRecord *>(bytes + ringOffset(head->worker_count));
+        return true;
+    }
+
+#endif
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "log_format.hpp"
+
+// ------------------- Shared-Memory Metrics ---------------------
+// A scheduler can publish live counters into a POSIX shared memory object
+// ("/anomsched" -> /dev/shm/anomsched) that tools such as anomsched-top
+// map read-only. Publishing is a handful of relaxed stores per job: no
+// syscalls and no locks, so monitoring costs the same whether anyone is
+// watching or not.
+//
+// Layout: ShmHeader, then worker_capacity ShmWorker slots, then a ring of
+// ring_capacity ShmRecord slots holding the most recent executions.
+// Per-worker slots and ring slots are seqlocks: the writer makes seq odd,
+// stores the fields, then makes it even again; readers retry until they
+// see the same even seq before and after copying. Every field is an
+// atomic so torn reads are retried rather than undefined.
+
+namespace shm
+{
+    constexpr char kMagic[8] = {'A', 'N', 'O', 'M', 'S', 'H', 'M', '\0'};
+    constexpr uint32_t kVersion = 1;
+    constexpr uint32_t kDefaultRingCapacity = 1024;
+
+    using Counter = std::atomic<uint64_t>;
+    using Signed = std::atomic<int64_t>;
+    static_assert(Counter::is_always_lock_free && Signed::is_always_lock_free,
+                  "shared-memory metrics need address-free 64-bit atomics");
+
+    struct ShmHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t worker_count;
+        uint32_t ring_capacity;
+        uint32_t reserved;
+        int64_t pid;
+        int64_t started_ns; // high_resolution_clock, like ExecutionRecord
+        // Scheduler-wide counters; single values, so no seqlock needed
+        Counter queued_jobs;
+        Counter accepted;
+        Counter rejected;
+        Counter shed;
+        Counter completed;
+        Counter anomalies;
+        Counter ring_head; // total records ever pushed into the ring
+    };
+
+    struct alignas(64) ShmWorker
+    {
+        Counter seq;
+        Counter jobs;
+        Counter anomalies;
+        Counter busy_ns;        // exec time of finished jobs
+        Counter current_job_id; // 0 = idle
+        Signed current_start_ns;
+        Counter local_depth;    // jobs routed to this worker's own queue
+    };
+
+    struct alignas(64) ShmRecord
+    {
+        Counter seq;
+        Counter job_id;
+        Signed thread_id;
+        Signed priority;
+        Signed submit_ns;
+        Signed start_ns;
+        Signed end_ns;
+        Counter is_anomaly;
+    };
+
+    struct WorkerView
+    {
+        uint64_t jobs = 0;
+        uint64_t anomalies = 0;
+        uint64_t busy_ns = 0;
+        uint64_t current_job_id = 0;
+        int64_t current_start_ns = 0;
+        uint64_t local_depth = 0;
+    };
+
+    // Owned by the scheduler; creates and, on destruction, unlinks the object
+    class Publisher
+    {
+    public:
+        ~Publisher();
+
+        bool create(const std::string &name, int worker_count, uint32_t ring_capacity, std::string &error);
+
+        ShmHeader *header() { return head; }
+
+        // Worker-only calls: each worker slot has exactly one writer.
+        // jobFinished(-1, ...) skips the slot and may come from any thread.
+        void jobStarted(int worker, uint64_t job_id, int64_t start_ns);
+        void jobFinished(int worker, const ExecutionRecord &record);
+
+        // Any thread: appends to the recent-records ring
+        void pushRecord(const ExecutionRecord &record);
+
+        // Any thread: producers and stealers update a worker's queue depth;
+        // the scheduler's queue_mutex serializes the writes
+        void setLocalDepth(int worker, size_t depth)
+        {
+            workers[worker].local_depth.store(depth, std::memory_order_relaxed);
+        }
+
+    private:
+        std::string name;
+        void *base = nullptr;
+        size_t size = 0;
+        ShmHeader *head = nullptr;
+        ShmWorker *workers = nullptr;
+        ShmRecord *ring = nullptr;
+    };
+
+    // Read-only attachment used by monitoring tools
+    class Reader
+    {
+    public:
+        ~Reader();
+
+        bool open(const std::string &name, std::string &error);
+        const ShmHeader &header() const { return *head; }
+        int workerCount() const { return (int)head->worker_count; }
+
+        WorkerView worker(int index) const;
+        // Up to max most recent records, newest first
+        size_t recent(ExecutionRecord *out, size_t max) const;
+
+    private:
+        const void *base = nullptr;
+        size_t size = 0;
+        const ShmHeader *head = nullptr;
+        const ShmWorker *workers = nullptr;
+        const ShmRecord *ring = nullptr;
+    };
+}
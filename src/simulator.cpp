@@ -0,0 +1,176 @@
+#include "simulator.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+    std::chrono::high_resolution_clock::time_point virtualTime(int64_t ns)
+    {
+        return std::chrono::high_resolution_clock::time_point(
+            std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(std::chrono::nanoseconds(ns)));
+    }
+
+    int64_t virtualNs(std::chrono::high_resolution_clock::time_point t)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+    }
+}
+
+Simulator::Simulator(int num_workers, const std::string &log_filename, const SchedulerOptions &options_)
+    : options(options_),
+      logger(log_filename, options_.log_format, num_workers, options_.log_rotation, options_.log_sampling),
+      running(num_workers), started_ns(num_workers)
+{
+    if (options.anomaly_detector)
+        logger.setDetector(options.anomaly_detector());
+    logger.setPrintAnomalies(options.print_anomalies);
+    // Popped from the back, so worker 0 takes the first job like a fresh pool
+    for (int w = num_workers - 1; w >= 0; --w)
+        idle.push_back(w);
+}
+
+bool Simulator::submit(const SimulatedJob &simulated)
+{
+    if (totals.admission.accepted + totals.admission.rejected + totals.admission.shed == 0)
+        totals.first_arrival_ns = simulated.arrival_ns;
+
+    Job job;
+    job.id = next_id++;
+    job.priority = simulated.priority;
+    job.job_class = simulated.job_class;
+    job.submit_time = virtualTime(simulated.arrival_ns);
+    // "Running" a simulated job just reports how long it would have taken
+    int64_t service = simulated.service_ns;
+    job.task = [this, service]
+    { service_ns = service; };
+
+    // A producer stuck behind a full queue or running a job itself submits
+    // late; the job still counts its wait from its intended arrival
+    int64_t now = std::max(simulated.arrival_ns, producer_free_ns);
+    advance(now);
+    if (!blocked.empty())
+    {
+        ++totals.admission.accepted;
+        blocked.push_back(std::move(job));
+        return true;
+    }
+
+    if (options.shed_queue_wait_ms > 0 && job.priority < options.shed_min_priority && queue.empty())
+        logger.noteEmptyQueue();
+    if (options.shed_queue_wait_ms > 0 && job.priority < options.shed_min_priority &&
+        logger.recentQueueWaitMS() > options.shed_queue_wait_ms)
+    {
+        ++totals.admission.shed;
+        return false;
+    }
+
+    const size_t capacity = options.queue_capacity;
+    if (capacity > 0 && queue.size() >= capacity)
+    {
+        switch (options.overflow_policy)
+        {
+        case OverflowPolicy::Block:
+            ++totals.admission.accepted;
+            blocked.push_back(std::move(job));
+            return true;
+        case OverflowPolicy::ShedLowestPriority:
+            ++totals.admission.shed;
+            if (queue.lowestPriority() >= job.priority)
+                return false;
+            queue.evictLowest();
+            break;
+        case OverflowPolicy::CallerRuns:
+        {
+            ++totals.admission.accepted;
+            ++totals.admission.caller_runs;
+            job.task();
+            producer_free_ns = now + service_ns;
+            complete(job, -1, now, producer_free_ns);
+            return true;
+        }
+        default:
+            ++totals.admission.rejected;
+            return false;
+        }
+    }
+
+    ++totals.admission.accepted;
+    queue.push(std::move(job));
+    dispatch(now);
+    return true;
+}
+
+void Simulator::finish()
+{
+    advance(std::numeric_limits<int64_t>::max());
+    logger.flush();
+}
+
+SimulationStats Simulator::stats() const
+{
+    SimulationStats s = totals;
+    s.wait = wait.snapshot();
+    s.exec = exec.snapshot();
+    s.response = response.snapshot();
+    s.log = logger.stats();
+    return s;
+}
+
+// Completes jobs in end-time order up to until_ns; each freed worker picks
+// up the next queued job at the instant it finished
+void Simulator::advance(int64_t until_ns)
+{
+    while (!completions.empty() && completions.top().end_ns <= until_ns)
+    {
+        Completion done = completions.top();
+        completions.pop();
+        complete(running[done.worker], done.worker, started_ns[done.worker], done.end_ns);
+        idle.push_back(done.worker);
+        dispatch(done.end_ns);
+    }
+}
+
+void Simulator::dispatch(int64_t now_ns)
+{
+    while (!idle.empty() && !queue.empty())
+    {
+        int worker = idle.back();
+        idle.pop_back();
+        start(queue.pop(), worker, now_ns);
+        // The freed slot lets a blocked producer through
+        if (!blocked.empty() && (options.queue_capacity == 0 || queue.size() < options.queue_capacity))
+        {
+            queue.push(std::move(blocked.front()));
+            blocked.pop_front();
+        }
+    }
+}
+
+void Simulator::start(Job job, int worker, int64_t now_ns)
+{
+    job.task();
+    started_ns[worker] = now_ns;
+    totals.busy_ns += service_ns;
+    completions.push({now_ns + service_ns, worker});
+    running[worker] = std::move(job);
+}
+
+void Simulator::complete(const Job &job, int thread_id, int64_t start_ns, int64_t end_ns)
+{
+    ExecutionRecord record;
+    record.job_id = job.id;
+    record.thread_id = thread_id;
+    record.priority = job.priority;
+    record.job_class = job.job_class;
+    record.submit_ns = virtualNs(job.submit_time);
+    record.start_ns = start_ns;
+    record.end_ns = end_ns;
+
+    wait.record(record.start_ns - record.submit_ns);
+    exec.record(record.end_ns - record.start_ns);
+    response.record(record.end_ns - record.submit_ns);
+    logger.log(record);
+
+    ++totals.completed;
+    totals.last_end_ns = std::max(totals.last_end_ns, end_ns);
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+#include "job_queue.hpp"
+#include "latency_histogram.hpp"
+#include "logger.hpp"
+#include "scheduler.hpp"
+
+// ------------------- Discrete-Event Simulator ---------------------
+// Runs a job stream through the scheduler's policies in virtual time, for
+// what-if capacity studies that would take minutes of wall clock on a real
+// pool. Jobs go through the same JobQueue ordering, the same admission
+// (queue capacity, overflow policy, load shedding on the logger's queue
+// wait) and the same Logger, so the log file and the anomaly verdicts come
+// out as a real run's would. Times in the log are virtual nanoseconds from
+// 0. Not modelled: affinity, the inline fast path, and scheduler overhead;
+// a worker starts its next job the instant the previous one ends.
+//
+//   Simulator sim(8, "whatif.bin");
+//   for (each job in arrival order)
+//       sim.submit({arrival_ns, service_ns, priority});
+//   sim.finish();
+//   SimulationStats s = sim.stats();
+
+struct SimulatedJob
+{
+    int64_t arrival_ns = 0; // non-decreasing across submit() calls
+    int64_t service_ns = 0;
+    int priority = 0;
+    uint8_t job_class = 0;
+};
+
+struct SimulationStats
+{
+    AdmissionStats admission;
+    uint64_t completed = 0;
+    int64_t first_arrival_ns = 0;
+    int64_t last_end_ns = 0;
+    int64_t busy_ns = 0; // service time run on workers, for utilization
+    HistogramSnapshot wait;
+    HistogramSnapshot exec;
+    HistogramSnapshot response; // arrival to end
+    LogStats log;
+};
+
+class Simulator
+{
+public:
+    Simulator(int num_workers, const std::string &log_filename, const SchedulerOptions &options = SchedulerOptions());
+
+    // Advances virtual time to the job's arrival, completing everything that
+    // ends before it, then admits the job. Returns false if it was refused.
+    bool submit(const SimulatedJob &job);
+
+    // Runs every admitted job to completion and flushes the log
+    void finish();
+
+    SimulationStats stats() const;
+
+private:
+    struct Completion
+    {
+        int64_t end_ns;
+        int worker;
+        bool operator>(const Completion &other) const
+        {
+            return end_ns != other.end_ns ? end_ns > other.end_ns : worker > other.worker;
+        }
+    };
+
+    void advance(int64_t until_ns);
+    void dispatch(int64_t now_ns);
+    void start(Job job, int worker, int64_t now_ns);
+    void complete(const Job &job, int thread_id, int64_t start_ns, int64_t end_ns);
+
+    SchedulerOptions options;
+    Logger logger;
+    JobQueue queue;
+    std::deque<Job> blocked;  // Block policy: the producer's backlog behind a full queue
+    std::vector<Job> running; // per worker
+    std::vector<int64_t> started_ns;
+    std::vector<int> idle;    // worker indices, used as a stack
+    std::priority_queue<Completion, std::vector<Completion>, std::greater<Completion>> completions;
+    int64_t producer_free_ns = 0; // CallerRuns: the producer is busy running a job until then
+    int64_t service_ns = 0;       // set by a simulated job's task when dispatched
+    uint64_t next_id = 1;
+
+    SimulationStats totals;
+    LatencyHistogram wait, exec, response;
+};
@@ -0,0 +1,157 @@
+#include "trace_export.hpp"
+#include <cinttypes>
+
+namespace
+{
+    // Track ids: submit arrows start on 0, caller-run jobs sit on 1, workers follow
+    constexpr int kSubmitTid = 0;
+    constexpr int kCallerTid = 1;
+
+    std::string jsonEscape(const std::string &text)
+    {
+        std::string escaped;
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                escaped += '\\';
+            if ((unsigned char)c >= 0x20)
+                escaped += c;
+        }
+        return escaped;
+    }
+
+    inline int tidOf(int thread_id)
+    {
+        return thread_id < 0 ? kCallerTid : thread_id + 2;
+    }
+
+    // Trace timestamps are microseconds; keep nanosecond precision
+    void putMicros(std::FILE *out, int64_t ns)
+    {
+        if (ns < 0)
+        {
+            std::fputc('-', out);
+            ns = -ns;
+        }
+        std::fprintf(out, "%" PRId64 ".%03d", ns / 1000, (int)(ns % 1000));
+    }
+}
+
+TraceWriter::TraceWriter(std::FILE *out_, const TraceOptions &options_)
+    : out(out_), options(options_)
+{
+}
+
+void TraceWriter::separator()
+{
+    if (!first_event)
+        std::fputs(",\n", out);
+    first_event = false;
+}
+
+const std::string &TraceWriter::className(uint8_t job_class)
+{
+    if (names.size() <= job_class)
+        names.resize(size_t(job_class) + 1);
+    std::string &name = names[job_class];
+    if (name.empty())
+    {
+        if (job_class < options.class_names.size() && !options.class_names[job_class].empty())
+            name = jsonEscape(options.class_names[job_class]);
+        else
+            name = job_class == 0 ? "job" : "class " + std::to_string(job_class);
+    }
+    return name;
+}
+
+void TraceWriter::begin(int thread_count)
+{
+    std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n", out);
+    separator();
+    std::fputs("{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,\"args\":{\"name\":\"AnomSched\"}}", out);
+
+    auto name_track = [this](int tid, const std::string &name)
+    {
+        separator();
+        std::fprintf(out, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                     tid, name.c_str());
+        separator();
+        std::fprintf(out, "{\"ph\":\"M\",\"name\":\"thread_sort_index\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+                     tid, tid);
+    };
+    name_track(kSubmitTid, "submit");
+    name_track(kCallerTid, "caller threads");
+    named_threads.assign((size_t)(thread_count > 0 ? thread_count : 0), true);
+    for (int i = 0; i < thread_count; ++i)
+        name_track(tidOf(i), "worker " + std::to_string(i));
+}
+
+void TraceWriter::add(const ExecutionRecord &r)
+{
+    int tid = tidOf(r.thread_id);
+    if (r.thread_id >= 0 && ((size_t)r.thread_id >= named_threads.size() || !named_threads[r.thread_id]))
+    {
+        // Worker beyond the header's thread count (or no header): name it now
+        if ((size_t)r.thread_id >= named_threads.size())
+            named_threads.resize((size_t)r.thread_id + 1, false);
+        named_threads[r.thread_id] = true;
+        separator();
+        std::fprintf(out, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"worker %d\"}}",
+                     tid, r.thread_id);
+    }
+
+    if (!options.has_origin)
+    {
+        options.origin_ns = r.submit_ns;
+        options.has_origin = true;
+    }
+
+    const std::string &cls = className(r.job_class);
+    int64_t submit = r.submit_ns - options.origin_ns;
+    int64_t start = r.start_ns - options.origin_ns;
+
+    separator();
+    std::fprintf(out, "{\"ph\":\"X\",\"name\":\"%s #%" PRIu64 " p%d\",\"pid\":1,\"tid\":%d,\"ts\":", cls.c_str(),
+                 r.job_id, r.priority, tid);
+    putMicros(out, start);
+    std::fputs(",\"dur\":", out);
+    putMicros(out, r.end_ns - r.start_ns);
+    std::fprintf(out, ",\"args\":{\"id\":\"%" PRIu64 "\",\"priority\":%d,\"class\":\"%s\",\"wait_us\":",
+                 r.job_id, r.priority, cls.c_str());
+    putMicros(out, r.start_ns - r.submit_ns);
+    std::fputs(r.is_anomaly ? ",\"anomaly\":true}}" : "}}", out);
+
+    if (options.flows)
+    {
+        // A flow must start inside a slice, so each submit gets a zero-length one
+        separator();
+        std::fprintf(out, "{\"ph\":\"X\",\"name\":\"submit\",\"pid\":1,\"tid\":%d,\"dur\":0,\"ts\":", kSubmitTid);
+        putMicros(out, submit);
+        std::fputs("}", out);
+        separator();
+        std::fprintf(out, "{\"ph\":\"s\",\"name\":\"queued\",\"cat\":\"flow\",\"id\":\"%" PRIu64 "\",\"pid\":1,\"tid\":%d,\"ts\":",
+                     r.job_id, kSubmitTid);
+        putMicros(out, submit);
+        std::fputs("}", out);
+        separator();
+        std::fprintf(out, "{\"ph\":\"f\",\"bp\":\"e\",\"name\":\"queued\",\"cat\":\"flow\",\"id\":\"%" PRIu64 "\",\"pid\":1,\"tid\":%d,\"ts\":",
+                     r.job_id, tid);
+        putMicros(out, start);
+        std::fputs("}", out);
+    }
+
+    if (r.is_anomaly)
+    {
+        separator();
+        std::fprintf(out, "{\"ph\":\"i\",\"s\":\"t\",\"name\":\"anomaly\",\"pid\":1,\"tid\":%d,\"ts\":", tid);
+        putMicros(out, start);
+        std::fprintf(out, ",\"args\":{\"id\":\"%" PRIu64 "\"}}", r.job_id);
+    }
+    ++job_count;
+}
+
+void TraceWriter::finish()
+{
+    std::fputs("\n]}\n", out);
+    std::fflush(out);
+}
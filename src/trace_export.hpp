@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "log_format.hpp"
+
+// ------------------- Trace Export ---------------------
+// Streams execution records as Chrome Trace Event JSON, which
+// ui.perfetto.dev and chrome://tracing open directly:
+//   - one track per worker (ThreadID -1 = caller-runs / inline jobs)
+//   - a slice per job named "<class> #<id> p<priority>", with the job ID,
+//     priority, class and queue wait also in its args
+//   - a flow arrow from the job's submit time on the "submit" track to
+//     the start of its slice
+//   - an instant "anomaly" marker on jobs the real-time detector flagged
+// Records are written as they arrive, so memory use is constant however
+// long the log is.
+
+struct TraceOptions
+{
+    bool flows = true;                    // submit -> start arrows (about half the output)
+    std::vector<std::string> class_names; // index = job class; missing -> "class N"
+    // Time 0 of the trace, normally the earliest submit_ns written. false:
+    // the first record's submit, so jobs submitted before the first one to
+    // complete get negative timestamps.
+    bool has_origin = false;
+    int64_t origin_ns = 0;
+};
+
+class TraceWriter
+{
+public:
+    TraceWriter(std::FILE *out, const TraceOptions &options);
+
+    // Names the tracks; call once before the first add()
+    void begin(int thread_count);
+    void add(const ExecutionRecord &record);
+    void finish();
+
+    uint64_t jobs() const { return job_count; }
+
+private:
+    void separator();
+    const std::string &className(uint8_t job_class);
+
+    std::FILE *out;
+    TraceOptions options;
+    std::vector<std::string> names; // per class, filled on first use
+    std::vector<bool> named_threads;
+    bool first_event = true;
+    uint64_t job_count = 0;
+};
@@ -0,0 +1,207 @@
+// anomsched-analyze: offline summary of an execution log (CSV or binary),
+// equivalent to ai/visualize_logs.py's statistics but computed in a single
+// parallel pass over a memory-mapped file.
+//
+//   anomsched-analyze execution_log.bin
+//   anomsched-analyze execution_log.csv --threads 8 --throughput windows.csv
+//
+// A rotated log is named by its base file; only the segments whose index
+// overlaps --from-ms/--to-ms are opened:
+//
+//   anomsched-analyze execution_log.bin --from-ms 1748258241000 --to-ms 1748258301000
+//
+// --score-detectors replays the log's execution times through every
+// built-in real-time detector and reports precision and recall against
+// the injected anomalies (jobs with a nonzero JobClass).
+#include "anomaly_detector.hpp"
+#include "log_analysis.hpp"
+#include "log_reader.hpp"
+#include "log_segments.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+    void usage(const char *argv0)
+    {
+        std::cerr << "usage: " << argv0 << " <log> [--threads N] [--window-ms MS] [--throughput out.csv]\n"
+                  << "       [--from-ms START] [--to-ms END] [--score-detectors]\n";
+    }
+
+    // Saturating ms -> ns for the open-ended default range
+    int64_t toNanoseconds(int64_t ms)
+    {
+        const int64_t limit = std::numeric_limits<int64_t>::max() / 1000000;
+        if (ms >= limit)
+            return std::numeric_limits<int64_t>::max();
+        if (ms <= -limit)
+            return std::numeric_limits<int64_t>::min();
+        return ms * 1000000;
+    }
+
+    double percent(uint64_t part, uint64_t total)
+    {
+        return total ? 100.0 * part / total : 0.0;
+    }
+
+    void printSummary(const LogSummary &s)
+    {
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << std::string(60, '=') << "\n"
+                  << "ANOMALY DETECTION SUMMARY\n"
+                  << std::string(60, '=') << "\n";
+        std::cout << "Total Jobs Processed: " << s.total_jobs << "\n";
+        std::cout << "Real-time Anomalies: " << s.realtime_anomalies
+                  << " (" << percent(s.realtime_anomalies, s.total_jobs) << "%)\n";
+        std::cout << "Statistical Anomalies: " << s.zscore_anomalies
+                  << " (" << percent(s.zscore_anomalies, s.total_jobs) << "%)\n";
+        std::cout << "IQR Anomalies: " << s.iqr_anomalies
+                  << " (" << percent(s.iqr_anomalies, s.total_jobs) << "%)"
+                  << "  bounds [" << s.iqr_lower << ", " << s.iqr_upper << "] ms\n";
+        std::cout << "Queue Wait Anomalies: " << s.wait_anomalies
+                  << " (" << percent(s.wait_anomalies, s.total_jobs) << "%)\n";
+        std::cout << "Both Real-time & Statistical: " << s.realtime_and_zscore << "\n";
+        if (s.realtime_anomalies > 0)
+        {
+            std::cout << "\nAnomaly Details:\n"
+                      << "  Average Duration: " << s.realtime_anomaly_mean_ms << "ms\n"
+                      << "  Max Duration: " << s.realtime_anomaly_max_ms << "ms\n";
+        }
+
+        std::cout << "\n--- Execution Duration Stats ---\n"
+                  << "Mean: " << s.exec.mean << " ms\n"
+                  << "Median: " << s.exec.median << " ms\n"
+                  << "Std Dev: " << s.exec.std_dev << " ms\n"
+                  << "Min: " << s.exec.min << " ms\n"
+                  << "Max: " << s.exec.max << " ms\n";
+
+        std::cout << "\n--- Queue Wait Stats ---\n"
+                  << "Mean Wait: " << s.wait.mean << " ms\n"
+                  << "Max Wait: " << s.wait.max << " ms\n"
+                  << "Jobs with >1s wait: " << s.waits_over_1s << "\n";
+
+        std::cout << "\n--- Thread Performance ---\n"
+                  << "ThreadID  count  mean    std     wait\n";
+        for (const ThreadSummary &t : s.threads)
+        {
+            std::cout << std::left << std::setw(10) << t.thread_id
+                      << std::setw(7) << t.count
+                      << std::setw(8) << t.exec_mean
+                      << std::setw(8) << t.exec_std
+                      << t.wait_mean << std::right << "\n";
+        }
+
+        uint64_t peak = 0, completed = 0;
+        for (uint64_t n : s.throughput)
+        {
+            peak = std::max(peak, n);
+            completed += n;
+        }
+        std::cout << "\n--- System Efficiency ---\n"
+                  << "Average Efficiency: " << std::setprecision(3) << s.mean_efficiency << "\n"
+                  << std::setprecision(1)
+                  << "Peak Throughput: " << peak << " jobs/" << s.window_ms << "ms\n"
+                  << "Mean Throughput: "
+                  << (s.throughput.empty() ? 0.0 : double(completed) / s.throughput.size())
+                  << " jobs/" << s.window_ms << "ms over " << s.throughput.size() << " windows\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::string log_path;
+    std::string throughput_path;
+    AnalysisOptions options;
+    bool score_detectors = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            options.threads = (unsigned)std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--window-ms") == 0 && i + 1 < argc)
+            options.window_ms = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--from-ms") == 0 && i + 1 < argc)
+            options.from_ms = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--to-ms") == 0 && i + 1 < argc)
+            options.to_ms = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--throughput") == 0 && i + 1 < argc)
+            throughput_path = argv[++i];
+        else if (std::strcmp(argv[i], "--score-detectors") == 0)
+            score_detectors = true;
+        else if (argv[i][0] != '-' && log_path.empty())
+            log_path = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (log_path.empty() || options.window_ms <= 0)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<std::string> files;
+    if (std::ifstream(log_path))
+    {
+        files.push_back(log_path);
+    }
+    else
+    {
+        files = selectSegments(log_path, toNanoseconds(options.from_ms), toNanoseconds(options.to_ms));
+        if (files.empty() && listSegments(log_path).empty())
+        {
+            std::cerr << argv[0] << ": cannot open " << log_path << "\n";
+            return 1;
+        }
+    }
+
+    LogSummary summary;
+    std::string error;
+    if (!analyzeLogs(files, options, summary, error))
+    {
+        std::cerr << argv[0] << ": " << error << "\n";
+        return 1;
+    }
+    printSummary(summary);
+
+    if (score_detectors)
+    {
+        // Detectors are sequential, so this is a second, single-threaded pass
+        std::vector<ExecutionRecord> records;
+        for (const std::string &file : files)
+        {
+            if (!readExecutionLog(file, records, error))
+            {
+                std::cerr << argv[0] << ": " << error << "\n";
+                return 1;
+            }
+        }
+        std::cout << "\n";
+        writeDetectorScores(std::cout, records);
+    }
+
+    if (!throughput_path.empty())
+    {
+        std::ofstream out(throughput_path);
+        out << "WindowStartMS,JobsCompleted\n";
+        for (size_t i = 0; i < summary.throughput.size(); ++i)
+            out << i * summary.window_ms << "," << summary.throughput[i] << "\n";
+        if (!out)
+        {
+            std::cerr << argv[0] << ": cannot write " << throughput_path << "\n";
+            return 1;
+        }
+    }
+    return 0;
+}
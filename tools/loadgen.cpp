@@ -0,0 +1,746 @@
+// anomsched-loadgen: drives a Scheduler with a synthetic workload and
+// reports throughput and latency percentiles, for capacity sizing.
+//
+//   anomsched-loadgen --arrival poisson --rate 20000 --service exp:40 --threads 8 --duration 10
+//   anomsched-loadgen --arrival bursty --rate 5000 --burst-size 50 --service lognormal:100:0.8
+//   anomsched-loadgen --arrival closed --clients 32 --think-us 500 --service uniform:50:150
+//   anomsched-loadgen --rate 2000 --anomaly cpu:0.01:20000 --anomaly io:0.01:50000 --json run.json
+//   anomsched-loadgen --replay execution_log.bin --threads 8
+//
+// Open-loop arrivals (poisson, bursty) are paced against a precomputed
+// schedule regardless of how fast jobs complete, so an overloaded pool shows
+// up as growing queue wait instead of a lower offered rate. Each job carries
+// its scheduled send time (JobOptions::intended_time) and latency is
+// measured from there: a producer that falls behind, for instance blocked
+// on a full queue, still charges the delay to the jobs it sent late instead
+// of omitting it. Closed-loop runs can instead apply HdrHistogram's
+// expected-interval correction (--expected-interval-us). Service times are
+// burned on the CPU (--service-mode spin) or slept (sleep). Injected
+// anomalies replace the job's normal work and are tagged with the same job
+// classes advancedStressTest uses: 1 cpu, 2 memory, 3 io, 4 contention.
+//
+// --replay re-submits the jobs of a recorded CSV or binary log with their
+// original inter-arrival gaps, priorities, job classes and service times,
+// then compares each job's queue wait and anomaly flag with the recording.
+// Jobs are matched by the ID the scheduler gave them; accepted jobs that a
+// later submission evicted from the queue are reported separately.
+// Binary logs replay exactly; CSV logs carry no priority and only
+// millisecond times.
+#include "latency_histogram.hpp"
+#include "lock_profiler.hpp"
+#include "log_reader.hpp"
+#include "scheduler.hpp"
+#include "service_time.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Pacing and client-side latency use the monotonic clock; send times are
+    // converted to Job::submit_time's clock only for JobOptions::intended_time
+    using Clock = std::chrono::steady_clock;
+    using SubmitClock = std::chrono::high_resolution_clock;
+
+    enum class Arrival
+    {
+        Poisson, // exponential inter-arrival gaps at --rate
+        Bursty,  // batches of --burst-size jobs, batches Poisson at rate / burst-size
+        Closed,  // --clients each submit, wait for completion, think, repeat
+        Replay   // gaps and jobs of a recorded log
+    };
+
+    std::vector<std::string> split(const std::string &text, char separator)
+    {
+        std::vector<std::string> parts;
+        size_t begin = 0;
+        while (true)
+        {
+            size_t end = text.find(separator, begin);
+            parts.push_back(text.substr(begin, end - begin));
+            if (end == std::string::npos)
+                return parts;
+            begin = end + 1;
+        }
+    }
+
+    // Indexed by job class: 1 cpu (spin us), 2 memory (MB), 3 io (sleep us),
+    // 4 contention (us holding a shared lock)
+    constexpr int kAnomalyClasses = 5;
+    const char *const kAnomalyNames[kAnomalyClasses] = {"normal", "cpu", "memory", "io", "contention"};
+
+    struct AnomalySpec
+    {
+        double probability = 0;
+        double amount = 0;
+    };
+
+    struct Workload
+    {
+        Arrival arrival = Arrival::Poisson;
+        double rate = 1000;  // open loop: jobs per second across all producers
+        int burst_size = 10; // bursty
+        int clients = 0;     // closed loop; 0 = one per worker
+        double think_us = 0; // closed loop: pause between a completion and the next submit
+        double expected_interval_us = 0; // closed loop: coordinated-omission correction, 0 = off
+        ServiceTimeDistribution service{ServiceTimeDistribution::Exponential, 100, 0};
+        bool spin = true;
+        AnomalySpec anomalies[kAnomalyClasses];
+        std::vector<double> priority_weights{1}; // weight of priority i
+        int threads = 4;
+        int producers = 1;
+        double duration_s = 10;
+        uint64_t seed = 1;
+        std::vector<ExecutionRecord> replay; // recorded jobs in submission order
+        double replay_speed = 1;             // >1 compresses the recorded gaps
+    };
+
+    // What one job will do, drawn by its producer
+    struct JobPlan
+    {
+        uint8_t job_class = 0;
+        uint8_t anomaly = 0; // injected work replacing service_ns, by job class
+        int priority = 0;
+        int64_t service_ns = 0;
+        double amount = 0;
+    };
+
+    // Shared with every job; counters are relaxed, histograms lock-free
+    struct RunState
+    {
+        LatencyHistogram response;    // scheduled send -> task end, as a client sees it
+        LatencyHistogram from_submit; // submit call -> task end, what a naive client measures
+        LatencyHistogram send_lag;    // scheduled send -> submit call
+        std::atomic<uint64_t> submitted{0};
+        std::atomic<uint64_t> completed{0};
+        std::atomic<uint64_t> injected[kAnomalyClasses] = {};
+        std::atomic<int64_t> last_completion_ns{0};
+        std::vector<std::pair<uint64_t, size_t>> replay_accepted; // replayed job ID, recorded job index
+        anomsched::mutex contended{"loadgen.contention"};
+        Clock::time_point origin = Clock::now();
+        SubmitClock::time_point submit_origin = SubmitClock::now(); // origin on SubmitClock
+
+        void setOrigin()
+        {
+            origin = Clock::now();
+            submit_origin = SubmitClock::now();
+        }
+
+        // One offset for the whole run, so converted times keep their spacing
+        SubmitClock::time_point toSubmitClock(Clock::time_point t) const
+        {
+            return submit_origin + std::chrono::duration_cast<SubmitClock::duration>(t - origin);
+        }
+    };
+
+    void spinFor(int64_t ns)
+    {
+        auto deadline = Clock::now() + std::chrono::nanoseconds(ns);
+        while (Clock::now() < deadline)
+        {
+        }
+    }
+
+    void serve(int64_t ns, bool spin)
+    {
+        if (spin)
+            spinFor(ns);
+        else
+            std::this_thread::sleep_for(std::chrono::nanoseconds(ns));
+    }
+
+    void runPlan(const JobPlan &plan, bool spin, RunState &state)
+    {
+        switch (plan.anomaly)
+        {
+        case 1:
+            spinFor(int64_t(plan.amount * 1000));
+            break;
+        case 2:
+        {
+            // Touch every page so the memory is really committed
+            std::vector<char> buffer(size_t(plan.amount * 1048576));
+            for (size_t i = 0; i < buffer.size(); i += 4096)
+                buffer[i] = char(i);
+            serve(plan.service_ns, spin);
+            break;
+        }
+        case 3:
+            std::this_thread::sleep_for(std::chrono::nanoseconds(int64_t(plan.amount * 1000)));
+            break;
+        case 4:
+        {
+            std::lock_guard<anomsched::mutex> lock(state.contended);
+            std::this_thread::sleep_for(std::chrono::nanoseconds(int64_t(plan.amount * 1000)));
+            break;
+        }
+        default:
+            serve(plan.service_ns, spin);
+        }
+    }
+
+    class Producer
+    {
+    public:
+        Producer(const Workload &workload_, uint64_t seed) : workload(workload_), rng(seed)
+        {
+            priorities = std::discrete_distribution<int>(workload.priority_weights.begin(),
+                                                         workload.priority_weights.end());
+        }
+
+        JobPlan plan()
+        {
+            JobPlan p;
+            p.priority = priorities(rng);
+            p.service_ns = int64_t(workload.service.sample(rng) * 1000);
+            double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+            for (int c = 1; c < kAnomalyClasses; ++c)
+            {
+                if (u < workload.anomalies[c].probability)
+                {
+                    p.job_class = p.anomaly = uint8_t(c);
+                    p.amount = workload.anomalies[c].amount;
+                    break;
+                }
+                u -= workload.anomalies[c].probability;
+            }
+            return p;
+        }
+
+        // Seconds until the next arrival at rate jobs/s
+        double gap(double rate)
+        {
+            return std::exponential_distribution<double>(rate)(rng);
+        }
+
+        double think()
+        {
+            return workload.think_us > 0 ? std::exponential_distribution<double>(1.0 / workload.think_us)(rng) : 0.0;
+        }
+
+    private:
+        const Workload &workload;
+        std::mt19937_64 rng;
+        std::discrete_distribution<int> priorities;
+    };
+
+    // Sleeps most of the way, then spins, so sub-100us gaps stay accurate
+    void waitUntil(Clock::time_point when)
+    {
+        auto now = Clock::now();
+        if (when - now > std::chrono::microseconds(200))
+            std::this_thread::sleep_until(when - std::chrono::microseconds(100));
+        while (Clock::now() < when)
+        {
+        }
+    }
+
+    int64_t nanosBetween(Clock::time_point from, Clock::time_point to)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+    }
+
+    bool submit(Scheduler &scheduler, const Workload &workload, RunState &state, const JobPlan &plan,
+                Clock::time_point intended, std::function<void()> done = nullptr, uint64_t *job_id = nullptr)
+    {
+        JobOptions options;
+        options.job_class = plan.job_class;
+        options.intended_time = state.toSubmitClock(intended);
+        auto submitted = Clock::now();
+        state.send_lag.record(nanosBetween(intended, submitted));
+        bool spin = workload.spin;
+        int64_t interval_ns = workload.arrival == Arrival::Closed ? int64_t(workload.expected_interval_us * 1000) : 0;
+        bool accepted = scheduler.submitJob([plan, spin, intended, submitted, interval_ns, &state, done]
+                                            {
+            runPlan(plan, spin, state);
+            auto finished = Clock::now();
+            state.response.recordCorrected(nanosBetween(intended, finished), interval_ns);
+            state.from_submit.record(nanosBetween(submitted, finished));
+            state.last_completion_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(finished - state.origin).count(),
+                                           std::memory_order_relaxed);
+            state.completed.fetch_add(1, std::memory_order_relaxed);
+            if (done)
+                done(); },
+                                            plan.priority, options, job_id);
+        state.submitted.fetch_add(1, std::memory_order_relaxed);
+        if (accepted)
+            state.injected[plan.anomaly].fetch_add(1, std::memory_order_relaxed);
+        return accepted;
+    }
+
+    // Open loop: producer `index` of `count` follows its own Poisson schedule
+    void openLoop(Scheduler &scheduler, const Workload &workload, RunState &state, int index, Clock::time_point end)
+    {
+        Producer producer(workload, workload.seed * 7919 + index);
+        int batch = workload.arrival == Arrival::Bursty ? std::max(1, workload.burst_size) : 1;
+        double batch_rate = workload.rate / workload.producers / batch;
+        auto next = Clock::now();
+        while (true)
+        {
+            next += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(producer.gap(batch_rate)));
+            if (next >= end)
+                return;
+            waitUntil(next);
+            for (int i = 0; i < batch; ++i)
+                submit(scheduler, workload, state, producer.plan(), next);
+        }
+    }
+
+    // Replay: remembers which scheduler job ID each accepted recorded job got
+    void replayLoop(Scheduler &scheduler, const Workload &workload, RunState &state)
+    {
+        const int64_t first_ns = workload.replay.front().submit_ns;
+        for (size_t i = 0; i < workload.replay.size(); ++i)
+        {
+            const ExecutionRecord &recorded = workload.replay[i];
+            auto when = state.origin + std::chrono::duration_cast<Clock::duration>(
+                                           std::chrono::duration<double, std::nano>((recorded.submit_ns - first_ns) / workload.replay_speed));
+            JobPlan plan;
+            plan.job_class = recorded.job_class;
+            plan.priority = recorded.priority;
+            plan.service_ns = recorded.end_ns - recorded.start_ns;
+            waitUntil(when);
+            uint64_t job_id = 0;
+            if (submit(scheduler, workload, state, plan, when, nullptr, &job_id))
+                state.replay_accepted.push_back({job_id, i});
+        }
+    }
+
+    // Closed loop: one outstanding job per client
+    void closedLoop(Scheduler &scheduler, const Workload &workload, RunState &state, int index, Clock::time_point end)
+    {
+        Producer producer(workload, workload.seed * 7919 + index);
+        while (Clock::now() < end)
+        {
+            auto finished = std::make_shared<std::promise<void>>();
+            std::future<void> ready = finished->get_future();
+            if (submit(scheduler, workload, state, producer.plan(), Clock::now(), [finished]
+                       { finished->set_value(); }))
+                ready.wait_until(end); // a shed job never completes
+            double think_us = producer.think();
+            if (think_us > 0)
+                std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(think_us));
+        }
+    }
+
+    // Recorded vs replayed behaviour of the jobs both runs completed
+    struct ReplayComparison
+    {
+        uint64_t matched = 0;
+        uint64_t evicted = 0; // accepted, then shed from the queue, so never logged
+        uint64_t flagged_both = 0;
+        uint64_t flagged_recorded_only = 0;
+        uint64_t flagged_replay_only = 0;
+        double mean_wait_delta_us = 0; // replayed minus recorded
+        double mean_abs_wait_delta_us = 0;
+        LatencyStats recorded_wait;
+        LatencyStats replayed_wait;
+    };
+
+    ReplayComparison compareReplay(const std::vector<ExecutionRecord> &recorded,
+                                   std::vector<std::pair<uint64_t, size_t>> accepted,
+                                   const std::vector<ExecutionRecord> &replayed)
+    {
+        std::sort(accepted.begin(), accepted.end());
+        LatencyHistogram recorded_wait, replayed_wait;
+        ReplayComparison c;
+        double delta_sum = 0, abs_delta_sum = 0;
+        for (const ExecutionRecord &after : replayed)
+        {
+            auto match = std::lower_bound(accepted.begin(), accepted.end(), std::make_pair(after.job_id, size_t(0)));
+            if (match == accepted.end() || match->first != after.job_id)
+                continue;
+            const ExecutionRecord &before = recorded[match->second];
+            int64_t wait_before = before.start_ns - before.submit_ns;
+            int64_t wait_after = after.start_ns - after.submit_ns;
+            recorded_wait.record(wait_before);
+            replayed_wait.record(wait_after);
+            delta_sum += (wait_after - wait_before) / 1e3;
+            abs_delta_sum += std::abs(wait_after - wait_before) / 1e3;
+            c.flagged_both += before.is_anomaly && after.is_anomaly;
+            c.flagged_recorded_only += before.is_anomaly && !after.is_anomaly;
+            c.flagged_replay_only += !before.is_anomaly && after.is_anomaly;
+            ++c.matched;
+        }
+        c.evicted = accepted.size() - c.matched;
+        if (c.matched > 0)
+        {
+            c.mean_wait_delta_us = delta_sum / c.matched;
+            c.mean_abs_wait_delta_us = abs_delta_sum / c.matched;
+        }
+        c.recorded_wait = recorded_wait.snapshot().stats();
+        c.replayed_wait = replayed_wait.snapshot().stats();
+        return c;
+    }
+
+    void printLatency(std::ostream &out, const char *name, const LatencyStats &s)
+    {
+        char line[160];
+        std::snprintf(line, sizeof(line), "  %-12s %10llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", name,
+                      (unsigned long long)s.count, s.mean_us, s.p50_us, s.p99_us, s.p999_us, s.max_us);
+        out << line;
+    }
+
+    void jsonLatency(std::ostream &out, const char *name, const LatencyStats &s, bool last)
+    {
+        out << "    \"" << name << "\": {\"count\": " << s.count << ", \"mean_us\": " << s.mean_us
+            << ", \"p50_us\": " << s.p50_us << ", \"p99_us\": " << s.p99_us << ", \"p999_us\": " << s.p999_us
+            << ", \"max_us\": " << s.max_us << "}" << (last ? "\n" : ",\n");
+    }
+
+    const char *arrivalName(Arrival arrival)
+    {
+        switch (arrival)
+        {
+        case Arrival::Bursty:
+            return "bursty";
+        case Arrival::Closed:
+            return "closed";
+        case Arrival::Replay:
+            return "replay";
+        default:
+            return "poisson";
+        }
+    }
+
+    void usage(const char *argv0)
+    {
+        std::cerr << "usage: " << argv0 << " [options]\n"
+                  << "  --arrival poisson|bursty|closed   arrival process (default poisson)\n"
+                  << "  --rate JOBS_PER_S                  open-loop target rate (default 1000)\n"
+                  << "  --burst-size N                     bursty: jobs per burst (default 10)\n"
+                  << "  --clients N --think-us US          closed loop: clients and mean think time\n"
+                  << "  --expected-interval-us US          closed loop: correct response latency for\n"
+                  << "                                     coordinated omission at this send interval\n"
+                  << "  --service DIST                     service time in us (default exp:100):\n"
+                  << "                                     const:US exp:MEAN uniform:MIN:MAX\n"
+                  << "                                     lognormal:MEDIAN:SIGMA pareto:MIN:ALPHA\n"
+                  << "  --service-mode spin|sleep          burn CPU or sleep (default spin)\n"
+                  << "  --replay LOG [--replay-speed X]    re-submit a recorded CSV/binary log's jobs, X times\n"
+                  << "                                     faster, and compare waits and anomaly flags\n"
+                  << "  --anomaly KIND:PROB:AMOUNT         cpu (spin us), memory (MB), io (sleep us),\n"
+                  << "                                     contention (us under a shared lock); repeatable\n"
+                  << "  --priorities LO-HI                 uniform priorities (default 0)\n"
+                  << "  --priority-weights W0,W1,...       weight of each priority from 0\n"
+                  << "  --threads N --producers N          workers and open-loop submitting threads\n"
+                  << "  --duration SECONDS --seed N\n"
+                  << "  --queue-capacity N --overflow block|reject|shed|caller\n"
+                  << "  --detector zscore|mad              real-time execution-time detector (default zscore)\n"
+                  << "  --log FILE                         keep the execution log (default: discarded)\n"
+                  << "  --json FILE                        also write the report as JSON\n"
+                  << "  --verbose                          show real-time anomaly messages\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Workload workload;
+    SchedulerOptions options;
+    options.print_anomalies = false;
+    std::string log_path, json_path, replay_path;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        std::string value = has_value ? argv[i + 1] : "";
+        bool ok = true;
+        if (arg == "--verbose")
+        {
+            options.print_anomalies = true;
+            continue;
+        }
+        if (!has_value)
+            ok = false;
+        else if (arg == "--arrival")
+        {
+            if (value == "poisson")
+                workload.arrival = Arrival::Poisson;
+            else if (value == "bursty")
+                workload.arrival = Arrival::Bursty;
+            else if (value == "closed")
+                workload.arrival = Arrival::Closed;
+            else
+                ok = false;
+        }
+        else if (arg == "--replay")
+        {
+            std::string error;
+            workload.arrival = Arrival::Replay;
+            workload.replay.clear();
+            if (!readExecutionLog(value, workload.replay, error) || workload.replay.empty())
+            {
+                std::cerr << argv[0] << ": " << (error.empty() ? value + ": no jobs to replay" : error) << "\n";
+                return 1;
+            }
+            replay_path = value;
+        }
+        else if (arg == "--replay-speed")
+            ok = (workload.replay_speed = std::atof(value.c_str())) > 0;
+        else if (arg == "--rate")
+            ok = (workload.rate = std::atof(value.c_str())) > 0;
+        else if (arg == "--burst-size")
+            ok = (workload.burst_size = std::atoi(value.c_str())) > 0;
+        else if (arg == "--clients")
+            ok = (workload.clients = std::atoi(value.c_str())) > 0;
+        else if (arg == "--think-us")
+            ok = (workload.think_us = std::atof(value.c_str())) >= 0;
+        else if (arg == "--expected-interval-us")
+            ok = (workload.expected_interval_us = std::atof(value.c_str())) >= 0;
+        else if (arg == "--service")
+            ok = parseServiceTime(value, workload.service);
+        else if (arg == "--service-mode")
+        {
+            ok = value == "spin" || value == "sleep";
+            workload.spin = value == "spin";
+        }
+        else if (arg == "--anomaly")
+        {
+            std::vector<std::string> p = split(value, ':');
+            int c = 1;
+            while (c < kAnomalyClasses && p[0] != kAnomalyNames[c])
+                ++c;
+            ok = p.size() == 3 && c < kAnomalyClasses;
+            if (ok)
+                workload.anomalies[c] = {std::atof(p[1].c_str()), std::atof(p[2].c_str())};
+        }
+        else if (arg == "--priorities")
+        {
+            std::vector<std::string> p = split(value, '-');
+            int lo = std::atoi(p[0].c_str());
+            int hi = p.size() > 1 ? std::atoi(p[1].c_str()) : lo;
+            ok = lo >= 0 && hi >= lo;
+            if (ok)
+            {
+                workload.priority_weights.assign(hi + 1, 0.0);
+                for (int prio = lo; prio <= hi; ++prio)
+                    workload.priority_weights[prio] = 1.0;
+            }
+        }
+        else if (arg == "--priority-weights")
+        {
+            workload.priority_weights.clear();
+            for (const std::string &w : split(value, ','))
+                workload.priority_weights.push_back(std::atof(w.c_str()));
+        }
+        else if (arg == "--threads")
+            ok = (workload.threads = std::atoi(value.c_str())) > 0;
+        else if (arg == "--producers")
+            ok = (workload.producers = std::atoi(value.c_str())) > 0;
+        else if (arg == "--duration")
+            ok = (workload.duration_s = std::atof(value.c_str())) > 0;
+        else if (arg == "--seed")
+            workload.seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--queue-capacity")
+            options.queue_capacity = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--overflow")
+        {
+            if (value == "block")
+                options.overflow_policy = OverflowPolicy::Block;
+            else if (value == "reject")
+                options.overflow_policy = OverflowPolicy::Reject;
+            else if (value == "shed")
+                options.overflow_policy = OverflowPolicy::ShedLowestPriority;
+            else if (value == "caller")
+                options.overflow_policy = OverflowPolicy::CallerRuns;
+            else
+                ok = false;
+        }
+        else if (arg == "--detector")
+        {
+            ok = makeAnomalyDetector(value) != nullptr;
+            options.anomaly_detector = [value]
+            { return makeAnomalyDetector(value); };
+        }
+        else if (arg == "--log")
+            log_path = value;
+        else if (arg == "--json")
+            json_path = value;
+        else
+            ok = false;
+        if (!ok)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        ++i;
+    }
+
+    double anomaly_total = 0;
+    for (int c = 1; c < kAnomalyClasses; ++c)
+        anomaly_total += workload.anomalies[c].probability;
+    if (anomaly_total > 1.0)
+    {
+        std::cerr << argv[0] << ": anomaly probabilities add up to more than 1\n";
+        return 2;
+    }
+
+    if (workload.arrival == Arrival::Replay)
+    {
+        std::stable_sort(workload.replay.begin(), workload.replay.end(), [](const ExecutionRecord &a, const ExecutionRecord &b)
+                         { return a.submit_ns != b.submit_ns ? a.submit_ns < b.submit_ns : a.job_id < b.job_id; });
+        workload.duration_s = std::max((workload.replay.back().submit_ns - workload.replay.front().submit_ns) / 1e9 /
+                                           workload.replay_speed,
+                                       1e-3);
+    }
+
+    bool keep_log = !log_path.empty();
+    if (!keep_log)
+        log_path = (std::filesystem::temp_directory_path() / "anomsched_loadgen.bin").string();
+
+    RunState state;
+    SchedulerSnapshot snap;
+    double elapsed_s = 0;
+    int clients = workload.clients > 0 ? workload.clients : workload.threads;
+    {
+        Scheduler scheduler(workload.threads, log_path, options);
+        scheduler.start();
+
+        state.setOrigin();
+        auto end = state.origin + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(workload.duration_s));
+        std::vector<std::thread> threads;
+        int thread_count = workload.arrival == Arrival::Closed ? clients : workload.producers;
+        if (workload.arrival == Arrival::Replay)
+            threads.emplace_back(replayLoop, std::ref(scheduler), std::cref(workload), std::ref(state));
+        for (int t = 0; t < thread_count && workload.arrival != Arrival::Replay; ++t)
+        {
+            if (workload.arrival == Arrival::Closed)
+                threads.emplace_back(closedLoop, std::ref(scheduler), std::cref(workload), std::ref(state), t, end);
+            else
+                threads.emplace_back(openLoop, std::ref(scheduler), std::cref(workload), std::ref(state), t, end);
+        }
+        for (auto &t : threads)
+            t.join();
+
+        // Drain what was accepted, so the tail of an overload shows up too
+        while (true)
+        {
+            SchedulerSnapshot pending = scheduler.snapshot();
+            if (pending.queued_jobs == 0 && pending.busy_workers == 0)
+                break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        scheduler.stop();
+        elapsed_s = std::max(state.last_completion_ns.load() / 1e9, workload.duration_s);
+        snap = scheduler.snapshot();
+    }
+    ReplayComparison comparison;
+    if (workload.arrival == Arrival::Replay)
+    {
+        std::vector<ExecutionRecord> replayed;
+        std::string error;
+        if (!readExecutionLog(log_path, replayed, error))
+            std::cerr << argv[0] << ": cannot compare the replay: " << error << "\n";
+        comparison = compareReplay(workload.replay, std::move(state.replay_accepted), replayed);
+    }
+    if (!keep_log)
+    {
+        std::error_code ignored;
+        std::filesystem::remove(log_path, ignored);
+    }
+
+    LatencyStats response = state.response.snapshot().stats();
+    LatencyStats from_submit = state.from_submit.snapshot().stats();
+    LatencyStats send_lag = state.send_lag.snapshot().stats();
+    uint64_t submitted = state.submitted, completed = state.completed;
+    uint64_t refused = snap.admission.rejected + snap.admission.shed; // shed includes evicted jobs
+    double offered = submitted / workload.duration_s;
+    double throughput = completed / elapsed_s;
+
+    char line[256];
+    if (workload.arrival == Arrival::Closed)
+        std::snprintf(line, sizeof(line), "anomsched-loadgen: closed loop, %d clients, think %.0f us", clients,
+                      workload.think_us);
+    else if (workload.arrival == Arrival::Replay)
+        std::snprintf(line, sizeof(line), "anomsched-loadgen: replay of %s (%zu jobs) at %gx", replay_path.c_str(),
+                      workload.replay.size(), workload.replay_speed);
+    else
+        std::snprintf(line, sizeof(line), "anomsched-loadgen: %s arrivals at %.1f jobs/s", arrivalName(workload.arrival),
+                      workload.rate);
+    std::cout << line << ", " << workload.threads << " workers, " << workload.duration_s << " s\n";
+    std::snprintf(line, sizeof(line), "submitted %llu (%.1f/s offered)  completed %llu  refused %llu\n",
+                  (unsigned long long)submitted, offered, (unsigned long long)completed, (unsigned long long)refused);
+    std::cout << line;
+    std::snprintf(line, sizeof(line), "throughput %.1f jobs/s over %.3f s\n\n", throughput, elapsed_s);
+    std::cout << line;
+    std::snprintf(line, sizeof(line), "  %-12s %10s %10s %10s %10s %10s %10s\n", "latency us", "count", "mean",
+                  "p50", "p99", "p99.9", "max");
+    std::cout << line;
+    printLatency(std::cout, "queue wait", snap.wait);
+    printLatency(std::cout, "service", snap.exec);
+    printLatency(std::cout, "response", response);
+    if (workload.arrival == Arrival::Replay)
+        printLatency(std::cout, "wait (rec)", comparison.recorded_wait);
+    if (workload.arrival != Arrival::Closed)
+    {
+        // What the run would have reported had latency started at the submit call
+        printLatency(std::cout, "from submit", from_submit);
+        printLatency(std::cout, "send lag", send_lag);
+    }
+    std::cout << "\ninjected:";
+    for (int c = 0; c < kAnomalyClasses; ++c)
+        std::cout << " " << kAnomalyNames[c] << " " << state.injected[c].load();
+    std::cout << "\nflagged by the real-time detector: " << snap.log.anomalies << "\n";
+    if (workload.arrival == Arrival::Replay)
+    {
+        std::snprintf(line, sizeof(line),
+                      "\nreplay vs recording, %llu jobs matched, %llu evicted after acceptance:\n"
+                      "  queue wait delta   mean %+.1f us, mean absolute %.1f us\n"
+                      "  anomaly flags      both %llu, recording only %llu, replay only %llu\n",
+                      (unsigned long long)comparison.matched, (unsigned long long)comparison.evicted,
+                      comparison.mean_wait_delta_us,
+                      comparison.mean_abs_wait_delta_us, (unsigned long long)comparison.flagged_both,
+                      (unsigned long long)comparison.flagged_recorded_only,
+                      (unsigned long long)comparison.flagged_replay_only);
+        std::cout << line;
+    }
+
+    if (!json_path.empty())
+    {
+        std::ofstream json(json_path);
+        json << "{\n  \"arrival\": \"" << arrivalName(workload.arrival) << "\",\n"
+             << "  \"target_rate\": " << (workload.arrival == Arrival::Poisson || workload.arrival == Arrival::Bursty ? workload.rate : 0.0) << ",\n"
+             << "  \"threads\": " << workload.threads << ",\n"
+             << "  \"duration_s\": " << workload.duration_s << ",\n"
+             << "  \"submitted\": " << submitted << ",\n"
+             << "  \"completed\": " << completed << ",\n"
+             << "  \"refused\": " << refused << ",\n"
+             << "  \"offered_rate\": " << offered << ",\n"
+             << "  \"throughput\": " << throughput << ",\n"
+             << "  \"anomalies_flagged\": " << snap.log.anomalies << ",\n";
+        if (workload.arrival == Arrival::Replay)
+            json << "  \"replay\": {\"matched\": " << comparison.matched << ", \"evicted\": " << comparison.evicted
+                 << ", \"mean_wait_delta_us\": " << comparison.mean_wait_delta_us
+                 << ", \"mean_abs_wait_delta_us\": " << comparison.mean_abs_wait_delta_us
+                 << ", \"flagged_both\": " << comparison.flagged_both
+                 << ", \"flagged_recorded_only\": " << comparison.flagged_recorded_only
+                 << ", \"flagged_replay_only\": " << comparison.flagged_replay_only << "},\n";
+        json << "  \"latency\": {\n";
+        jsonLatency(json, "queue_wait", snap.wait, false);
+        jsonLatency(json, "service", snap.exec, false);
+        if (workload.arrival == Arrival::Replay)
+            jsonLatency(json, "recorded_wait", comparison.recorded_wait, false);
+        jsonLatency(json, "response", response, false);
+        jsonLatency(json, "from_submit", from_submit, false);
+        jsonLatency(json, "send_lag", send_lag, true);
+        json << "  }\n}\n";
+        if (!json)
+        {
+            std::cerr << argv[0] << ": error writing " << json_path << "\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
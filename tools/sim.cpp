@@ -0,0 +1,289 @@
+// anomsched-sim: what-if capacity studies on the discrete-event simulator.
+// Replays the same synthetic job stream through the scheduler's queue
+// policy at each worker count in virtual time, millions of jobs per second
+// instead of the jobs' real duration.
+//
+//   anomsched-sim --workers 1,2,4,8,16 --rate 50000 --service exp:100 --jobs 5000000
+//   anomsched-sim --workers 8 --rate 90000 --service lognormal:80:1 --queue-capacity 1000 --overflow shed --priorities 0-9
+//   anomsched-sim --workers 4 --rate 30000 --anomaly 0.01:20000 --log whatif.bin
+//
+// Every worker count sees the identical stream (same --seed), so rows differ
+// only by capacity. --log writes the simulated execution log in the usual
+// formats, with virtual times starting at 0, for logcat, analyze and
+// visualize_logs.py.
+#include "service_time.hpp"
+#include "simulator.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct Stream
+    {
+        bool bursty = false;
+        double rate = 10000; // jobs per virtual second
+        int burst_size = 10;
+        ServiceTimeDistribution service{ServiceTimeDistribution::Exponential, 100, 0};
+        double anomaly_probability = 0;
+        double anomaly_us = 0;
+        uint8_t anomaly_class = 1;
+        int priority_lo = 0, priority_hi = 0;
+        uint64_t jobs = 1000000;
+        uint64_t seed = 1;
+    };
+
+    std::vector<int> parseList(const std::string &text)
+    {
+        std::vector<int> values;
+        size_t begin = 0;
+        while (begin <= text.size())
+        {
+            size_t end = text.find(',', begin);
+            if (end == std::string::npos)
+                end = text.size();
+            values.push_back(std::atoi(text.substr(begin, end - begin).c_str()));
+            begin = end + 1;
+        }
+        return values;
+    }
+
+    // whatif.bin -> whatif.w8.bin when sweeping several worker counts
+    std::string sweepLogName(const std::string &path, int workers)
+    {
+        std::filesystem::path p(path);
+        return (p.parent_path() / (p.stem().string() + ".w" + std::to_string(workers) + p.extension().string())).string();
+    }
+
+    struct Row
+    {
+        int workers;
+        SimulationStats stats;
+        double wall_s;
+    };
+
+    Row simulate(const Stream &stream, int workers, const std::string &log_path, const SchedulerOptions &options)
+    {
+        Simulator sim(workers, log_path, options);
+        std::mt19937_64 rng(stream.seed);
+        std::exponential_distribution<double> gap(stream.rate / (stream.bursty ? stream.burst_size : 1));
+        std::uniform_int_distribution<int> priority(stream.priority_lo, stream.priority_hi);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+        auto wall_start = std::chrono::steady_clock::now();
+        double arrival_s = 0;
+        uint64_t submitted = 0;
+        while (submitted < stream.jobs)
+        {
+            arrival_s += gap(rng);
+            int batch = stream.bursty ? stream.burst_size : 1;
+            for (int i = 0; i < batch && submitted < stream.jobs; ++i, ++submitted)
+            {
+                SimulatedJob job;
+                job.arrival_ns = int64_t(arrival_s * 1e9);
+                job.priority = priority(rng);
+                double service_us = stream.service.sample(rng);
+                if (stream.anomaly_probability > 0 && unit(rng) < stream.anomaly_probability)
+                {
+                    service_us = stream.anomaly_us;
+                    job.job_class = stream.anomaly_class;
+                }
+                job.service_ns = int64_t(service_us * 1000);
+                sim.submit(job);
+            }
+        }
+        sim.finish();
+        double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+        return Row{workers, sim.stats(), wall_s};
+    }
+
+    void usage(const char *argv0)
+    {
+        std::cerr << "usage: " << argv0 << " [options]\n"
+                  << "  --workers N[,N...]               worker counts to compare (default 1,2,4,8)\n"
+                  << "  --arrival poisson|bursty         arrival process (default poisson)\n"
+                  << "  --rate JOBS_PER_S                mean arrival rate in virtual time (default 10000)\n"
+                  << "  --burst-size N                   bursty: jobs per burst (default 10)\n"
+                  << "  --service DIST                   service time in us (default exp:100):\n"
+                  << "                                   const:US exp:MEAN uniform:MIN:MAX\n"
+                  << "                                   lognormal:MEDIAN:SIGMA pareto:MIN:ALPHA\n"
+                  << "  --anomaly PROB:US[:CLASS]        replace a job's service time with US (job class 1)\n"
+                  << "  --priorities LO-HI               uniform priorities (default 0)\n"
+                  << "  --jobs N --seed N                stream length (default 1000000) and seed\n"
+                  << "  --queue-capacity N --overflow block|reject|shed|caller\n"
+                  << "  --shed-wait-ms MS --shed-min-priority P\n"
+                  << "  --detector zscore|mad            real-time execution-time detector (default zscore)\n"
+                  << "  --log FILE                       write the simulated log (.csv, .bin or .binz)\n"
+                  << "  --csv FILE                       also write the table as CSV\n";
+    }
+}
+
+int main(int argc, char **argv)
+{
+    Stream stream;
+    SchedulerOptions options;
+    options.print_anomalies = false;
+    std::vector<int> worker_counts{1, 2, 4, 8};
+    std::string log_path, csv_path;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        std::string value = argv[++i];
+        bool ok = true;
+        if (arg == "--workers")
+        {
+            worker_counts = parseList(value);
+            for (int w : worker_counts)
+                ok = ok && w > 0;
+        }
+        else if (arg == "--arrival")
+        {
+            ok = value == "poisson" || value == "bursty";
+            stream.bursty = value == "bursty";
+        }
+        else if (arg == "--rate")
+            ok = (stream.rate = std::atof(value.c_str())) > 0;
+        else if (arg == "--burst-size")
+            ok = (stream.burst_size = std::atoi(value.c_str())) > 0;
+        else if (arg == "--service")
+            ok = parseServiceTime(value, stream.service);
+        else if (arg == "--anomaly")
+        {
+            char *end;
+            stream.anomaly_probability = std::strtod(value.c_str(), &end);
+            ok = *end == ':';
+            if (ok)
+                stream.anomaly_us = std::strtod(end + 1, &end);
+            if (ok && *end == ':')
+                stream.anomaly_class = uint8_t(std::atoi(end + 1));
+            ok = ok && stream.anomaly_probability >= 0 && stream.anomaly_probability <= 1;
+        }
+        else if (arg == "--priorities")
+        {
+            char *end;
+            stream.priority_lo = int(std::strtol(value.c_str(), &end, 10));
+            stream.priority_hi = *end == '-' ? std::atoi(end + 1) : stream.priority_lo;
+            ok = stream.priority_lo >= 0 && stream.priority_hi >= stream.priority_lo;
+        }
+        else if (arg == "--jobs")
+            ok = (stream.jobs = std::strtoull(value.c_str(), nullptr, 10)) > 0;
+        else if (arg == "--seed")
+            stream.seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--queue-capacity")
+            options.queue_capacity = std::strtoull(value.c_str(), nullptr, 10);
+        else if (arg == "--overflow")
+        {
+            if (value == "block")
+                options.overflow_policy = OverflowPolicy::Block;
+            else if (value == "reject")
+                options.overflow_policy = OverflowPolicy::Reject;
+            else if (value == "shed")
+                options.overflow_policy = OverflowPolicy::ShedLowestPriority;
+            else if (value == "caller")
+                options.overflow_policy = OverflowPolicy::CallerRuns;
+            else
+                ok = false;
+        }
+        else if (arg == "--shed-wait-ms")
+            options.shed_queue_wait_ms = std::atof(value.c_str());
+        else if (arg == "--shed-min-priority")
+            options.shed_min_priority = std::atoi(value.c_str());
+        else if (arg == "--detector")
+        {
+            ok = makeAnomalyDetector(value) != nullptr;
+            options.anomaly_detector = [value]
+            { return makeAnomalyDetector(value); };
+        }
+        else if (arg == "--log")
+            log_path = value;
+        else if (arg == "--csv")
+            csv_path = value;
+        else
+            ok = false;
+        if (!ok)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    // Without --log nothing is persisted, but the detector still sees every job
+    bool keep_log = !log_path.empty();
+    if (!keep_log)
+    {
+        log_path = (std::filesystem::temp_directory_path() / "anomsched_sim.bin").string();
+        options.log_sampling.mode = SamplingMode::OneInN;
+        options.log_sampling.one_in_n = std::numeric_limits<uint32_t>::max();
+        options.log_sampling.keep_anomalies = false;
+    }
+
+    char line[256];
+    std::snprintf(line, sizeof(line), "anomsched-sim: %llu %s arrivals at %.1f jobs/s, mean service %.1f us\n\n",
+                  (unsigned long long)stream.jobs, stream.bursty ? "bursty" : "poisson", stream.rate,
+                  stream.service.mean());
+    std::cout << line;
+    std::snprintf(line, sizeof(line), "%7s %10s %7s %12s %10s %10s %10s %10s %10s %9s\n", "workers", "refused", "util",
+                  "throughput", "wait p50", "wait p99", "wait p99.9", "resp p99", "anomalies", "sim Mj/s");
+    std::cout << line;
+
+    std::vector<Row> rows;
+    for (int workers : worker_counts)
+    {
+        std::string path = keep_log && worker_counts.size() > 1 ? sweepLogName(log_path, workers) : log_path;
+        Row row = simulate(stream, workers, path, options);
+        if (!keep_log)
+        {
+            std::error_code ignored;
+            std::filesystem::remove(path, ignored);
+        }
+        const SimulationStats &s = row.stats;
+        double span_s = (s.last_end_ns - s.first_arrival_ns) / 1e9;
+        double utilization = span_s > 0 ? s.busy_ns / 1e9 / span_s / workers : 0;
+        std::snprintf(line, sizeof(line), "%7d %10llu %6.1f%% %12.1f %10.1f %10.1f %10.1f %10.1f %10llu %9.2f\n",
+                      workers, (unsigned long long)(s.admission.rejected + s.admission.shed), utilization * 100,
+                      span_s > 0 ? s.completed / span_s : 0.0, s.wait.valueAtQuantile(0.5) / 1e3,
+                      s.wait.valueAtQuantile(0.99) / 1e3, s.wait.valueAtQuantile(0.999) / 1e3,
+                      s.response.valueAtQuantile(0.99) / 1e3, (unsigned long long)s.log.anomalies,
+                      row.wall_s > 0 ? stream.jobs / row.wall_s / 1e6 : 0.0);
+        std::cout << line << std::flush;
+        rows.push_back(std::move(row));
+    }
+
+    if (!csv_path.empty())
+    {
+        std::ofstream csv(csv_path);
+        csv << "Workers,Submitted,Completed,Refused,Utilization,Throughput,WaitP50US,WaitP99US,WaitP999US,"
+               "ResponseP99US,Anomalies\n";
+        for (const Row &row : rows)
+        {
+            const SimulationStats &s = row.stats;
+            double span_s = (s.last_end_ns - s.first_arrival_ns) / 1e9;
+            csv << row.workers << "," << stream.jobs << "," << s.completed << ","
+                << (s.admission.rejected + s.admission.shed) << ","
+                << (span_s > 0 ? s.busy_ns / 1e9 / span_s / row.workers : 0) << ","
+                << (span_s > 0 ? s.completed / span_s : 0) << "," << s.wait.valueAtQuantile(0.5) / 1e3 << ","
+                << s.wait.valueAtQuantile(0.99) / 1e3 << "," << s.wait.valueAtQuantile(0.999) / 1e3 << ","
+                << s.response.valueAtQuantile(0.99) / 1e3 << "," << s.log.anomalies << "\n";
+        }
+        if (!csv)
+        {
+            std::cerr << argv[0] << ": error writing " << csv_path << "\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
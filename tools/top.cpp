@@ -0,0 +1,172 @@
+// anomsched-top: live per-worker view of a running scheduler, read from the
+// shared memory object it publishes (SchedulerOptions::shm_metrics_name).
+// Attaching is read-only and costs the scheduler nothing.
+//
+//   anomsched-top                      # attaches to /anomsched
+//   anomsched-top --name /myapp --interval-ms 500
+//   anomsched-top --iterations 1       # one sample, e.g. for scripts
+#include "shm_metrics.hpp"
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace
+{
+    void usage(const char *argv0)
+    {
+        std::cerr << "usage: " << argv0 << " [--name /anomsched] [--interval-ms MS] [--iterations N]\n";
+    }
+
+    int64_t nowNs()
+    {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(high_resolution_clock::now().time_since_epoch()).count();
+    }
+
+    bool processAlive(int64_t pid)
+    {
+        return kill((pid_t)pid, 0) == 0 || errno == EPERM;
+    }
+
+    struct Sample
+    {
+        int64_t at_ns = 0;
+        uint64_t completed = 0;
+        uint64_t anomalies = 0;
+        std::vector<shm::WorkerView> workers;
+    };
+
+    Sample takeSample(const shm::Reader &reader)
+    {
+        Sample s;
+        s.at_ns = nowNs();
+        s.completed = reader.header().completed.load(std::memory_order_relaxed);
+        s.anomalies = reader.header().anomalies.load(std::memory_order_relaxed);
+        for (int i = 0; i < reader.workerCount(); ++i)
+            s.workers.push_back(reader.worker(i));
+        return s;
+    }
+
+    // Busy time including the part of the running job done so far
+    double busyNs(const shm::WorkerView &w, int64_t at_ns)
+    {
+        double busy = (double)w.busy_ns;
+        if (w.current_job_id != 0 && at_ns > w.current_start_ns)
+            busy += double(at_ns - w.current_start_ns);
+        return busy;
+    }
+
+    void render(const shm::Reader &reader, const Sample &prev, const Sample &cur)
+    {
+        const shm::ShmHeader &h = reader.header();
+        double seconds = double(cur.at_ns - prev.at_ns) / 1e9;
+        if (seconds <= 0)
+            seconds = 1e-9;
+
+        std::printf("anomsched-top  pid %lld  up %.1fs  queued %llu  jobs/s %.1f  anomalies/s %.1f\n",
+                    (long long)h.pid, double(cur.at_ns - h.started_ns) / 1e9,
+                    (unsigned long long)h.queued_jobs.load(std::memory_order_relaxed),
+                    double(cur.completed - prev.completed) / seconds,
+                    double(cur.anomalies - prev.anomalies) / seconds);
+        std::printf("accepted %llu  rejected %llu  shed %llu  completed %llu  anomalies %llu\n\n",
+                    (unsigned long long)h.accepted.load(std::memory_order_relaxed),
+                    (unsigned long long)h.rejected.load(std::memory_order_relaxed),
+                    (unsigned long long)h.shed.load(std::memory_order_relaxed),
+                    (unsigned long long)cur.completed, (unsigned long long)cur.anomalies);
+
+        std::printf("%6s %6s %9s %6s %7s %20s %10s\n", "WORKER", "BUSY%", "JOBS/S", "ANOM%", "LOCALQ",
+                    "CURRENT JOB", "RUNNING");
+        for (size_t i = 0; i < cur.workers.size(); ++i)
+        {
+            const shm::WorkerView &a = prev.workers[i];
+            const shm::WorkerView &b = cur.workers[i];
+            double busy = 100.0 * (busyNs(b, cur.at_ns) - busyNs(a, prev.at_ns)) / (seconds * 1e9);
+            uint64_t jobs = b.jobs - a.jobs;
+            double anomaly_pct = jobs ? 100.0 * double(b.anomalies - a.anomalies) / jobs : 0.0;
+            std::printf("%6zu %6.1f %9.1f %6.1f %7llu ", i, busy < 0 ? 0.0 : (busy > 100 ? 100.0 : busy),
+                        jobs / seconds, anomaly_pct, (unsigned long long)b.local_depth);
+            if (b.current_job_id != 0)
+                std::printf("%20llu %8.1fms\n", (unsigned long long)b.current_job_id,
+                            double(cur.at_ns - b.current_start_ns) / 1e6);
+            else
+                std::printf("%20s %10s\n", "-", "idle");
+        }
+
+        ExecutionRecord recent[shm::kDefaultRingCapacity];
+        size_t n = reader.recent(recent, shm::kDefaultRingCapacity);
+        std::printf("\nRECENT ANOMALIES\n");
+        int shown = 0;
+        for (size_t i = 0; i < n && shown < 5; ++i)
+        {
+            const ExecutionRecord &r = recent[i];
+            if (!r.is_anomaly)
+                continue;
+            std::printf("  job %llu  thread %d  priority %d  exec %.1fms  wait %.1fms\n",
+                        (unsigned long long)r.job_id, r.thread_id, r.priority,
+                        double(r.end_ns - r.start_ns) / 1e6, double(r.start_ns - r.submit_ns) / 1e6);
+            ++shown;
+        }
+        if (shown == 0)
+            std::printf("  (none in the last %zu jobs)\n", n);
+        std::fflush(stdout);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string name = "/anomsched";
+    int interval_ms = 1000;
+    long iterations = -1;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--name") == 0 && i + 1 < argc)
+            name = argv[++i];
+        else if (std::strcmp(argv[i], "--interval-ms") == 0 && i + 1 < argc)
+            interval_ms = std::atoi(argv[++i]);
+        else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            iterations = std::atol(argv[++i]);
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (interval_ms <= 0)
+        interval_ms = 1000;
+
+    shm::Reader reader;
+    std::string error;
+    if (!reader.open(name, error))
+    {
+        std::cerr << argv[0] << ": " << error << "\n";
+        return 1;
+    }
+
+    bool tty = isatty(STDOUT_FILENO);
+    Sample prev = takeSample(reader);
+    for (long round = 0; iterations < 0 || round < iterations; ++round)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+        Sample cur = takeSample(reader);
+        if (tty)
+            std::printf("\x1b[H\x1b[2J");
+        render(reader, prev, cur);
+        if (!processAlive(reader.header().pid))
+        {
+            std::printf("\nprocess %lld has exited\n", (long long)reader.header().pid);
+            return 0;
+        }
+        if (!tty)
+            std::printf("\n");
+        prev = std::move(cur);
+    }
+    return 0;
+}
@@ -0,0 +1,174 @@
+// anomsched-trace: converts a binary execution log (.bin or .binz) into
+// Chrome Trace Event JSON for ui.perfetto.dev or chrome://tracing.
+//
+//   anomsched-trace execution_log.binz trace.json
+//   anomsched-trace execution_log.bin trace.json --class-names normal,cpu,memory,io,contention
+//
+// Records come in completion order, so a first pass finds the earliest
+// submit time, which becomes time 0 of the trace. Traces of multi-million-job runs get large (~400 bytes per job with
+// flows, ~150 without); --no-flows and --from-ms/--to-ms keep them
+// manageable. A rotated log is named by its base file, as for
+// anomsched-analyze.
+#include "log_reader.hpp"
+#include "log_segments.hpp"
+#include "trace_export.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+    void usage(const char *argv0)
+    {
+        std::cerr << "usage: " << argv0 << " <log.bin|log.binz> <out.json> [--from-ms START] [--to-ms END]\n"
+                  << "       [--no-flows] [--class-names name0,name1,...]\n";
+    }
+
+    int64_t toNanoseconds(int64_t ms)
+    {
+        const int64_t limit = std::numeric_limits<int64_t>::max() / 1000000;
+        if (ms >= limit)
+            return std::numeric_limits<int64_t>::max();
+        if (ms <= -limit)
+            return std::numeric_limits<int64_t>::min();
+        return ms * 1000000;
+    }
+
+    std::vector<std::string> split(const std::string &list)
+    {
+        std::vector<std::string> parts;
+        size_t begin = 0;
+        while (true)
+        {
+            size_t comma = list.find(',', begin);
+            parts.push_back(list.substr(begin, comma - begin));
+            if (comma == std::string::npos)
+                return parts;
+            begin = comma + 1;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::string in_path, out_path;
+    int64_t from_ms = std::numeric_limits<int64_t>::min();
+    int64_t to_ms = std::numeric_limits<int64_t>::max();
+    TraceOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--from-ms") == 0 && i + 1 < argc)
+            from_ms = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--to-ms") == 0 && i + 1 < argc)
+            to_ms = std::atoll(argv[++i]);
+        else if (std::strcmp(argv[i], "--no-flows") == 0)
+            options.flows = false;
+        else if (std::strcmp(argv[i], "--class-names") == 0 && i + 1 < argc)
+            options.class_names = split(argv[++i]);
+        else if (argv[i][0] != '-' && in_path.empty())
+            in_path = argv[i];
+        else if (argv[i][0] != '-' && out_path.empty())
+            out_path = argv[i];
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (in_path.empty() || out_path.empty())
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    const int64_t from_ns = toNanoseconds(from_ms);
+    const int64_t to_ns = toNanoseconds(to_ms);
+    std::vector<std::string> files;
+    if (std::filesystem::exists(in_path))
+        files.push_back(in_path);
+    else
+        files = selectSegments(in_path, from_ns, to_ns);
+    if (files.empty())
+    {
+        std::cerr << argv[0] << ": no log or segments found for " << in_path << "\n";
+        return 1;
+    }
+
+    const int64_t ns_per_ms = 1000000;
+    auto selected = [from_ms, to_ms](const ExecutionRecord &record)
+    {
+        int64_t start_ms = record.start_ns / ns_per_ms;
+        return start_ms >= from_ms && start_ms <= to_ms;
+    };
+
+    // First pass: thread count and the earliest submit of the jobs written
+    int thread_count = 0;
+    for (const std::string &file : files)
+    {
+        LogReader reader;
+        std::string error;
+        if (!reader.open(file, error))
+        {
+            std::cerr << argv[0] << ": " << error << "\n";
+            return 1;
+        }
+        if (file == files.front())
+            thread_count = reader.header().thread_count;
+        if (from_ms != std::numeric_limits<int64_t>::min())
+            reader.seekTime(from_ns);
+
+        ExecutionRecord record;
+        while (reader.next(record))
+        {
+            if (!selected(record) || (options.has_origin && record.submit_ns >= options.origin_ns))
+                continue;
+            options.origin_ns = record.submit_ns;
+            options.has_origin = true;
+        }
+    }
+
+    std::FILE *out = std::fopen(out_path.c_str(), "wb");
+    if (!out)
+    {
+        std::cerr << argv[0] << ": cannot open " << out_path << " for writing\n";
+        return 1;
+    }
+    static char buffer[1 << 20];
+    std::setvbuf(out, buffer, _IOFBF, sizeof(buffer));
+
+    TraceWriter writer(out, options);
+    writer.begin(thread_count);
+    for (const std::string &file : files)
+    {
+        LogReader reader;
+        std::string error;
+        if (!reader.open(file, error))
+        {
+            std::cerr << argv[0] << ": " << error << "\n";
+            std::fclose(out);
+            return 1;
+        }
+        if (from_ms != std::numeric_limits<int64_t>::min())
+            reader.seekTime(from_ns);
+
+        ExecutionRecord record;
+        while (reader.next(record))
+        {
+            if (selected(record))
+                writer.add(record);
+        }
+    }
+    writer.finish();
+
+    bool ok = std::ferror(out) == 0;
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok)
+    {
+        std::cerr << argv[0] << ": error writing " << out_path << "\n";
+        return 1;
+    }
+    std::cerr << writer.jobs() << " jobs written to " << out_path << "\n";
+    return 0;
+}